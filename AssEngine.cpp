@@ -0,0 +1,58 @@
+#include "AssEngine.h"
+#include "PlayerLog.h"
+#include <QElapsedTimer>
+#include <QtDebug>
+
+AssEngine::~AssEngine() { release(); }
+
+ASS_Library *AssEngine::library() {
+  if (!m_library)
+    m_library = ass_library_init();
+  return m_library;
+}
+
+void AssEngine::setReadyCallback(const std::function<void()> &ready) {
+  m_onReady = ready;
+}
+
+void AssEngine::startRenderer() {
+  if (!m_library || m_thread.joinable() || m_ready)
+    return;
+  m_thread = std::thread(&AssEngine::initRenderer, this);
+}
+
+void AssEngine::initRenderer() {
+  QElapsedTimer timer;
+  timer.start();
+
+  ASS_Renderer *renderer = ass_renderer_init(m_library);
+  if (!renderer) {
+    qWarning() << "libass: renderer init failed";
+    return;
+  }
+
+  ass_set_fonts(renderer, nullptr, "Microsoft YaHei", 1, nullptr, 1);
+  // 默认缓存上限按桌面设定（位图缓存上百 MB），按本机内存预算收紧
+  ass_set_cache_limits(renderer, GLYPH_CACHE_MAX, BITMAP_CACHE_MB);
+
+  m_renderer = renderer;
+  m_ready = true;
+  qCDebug(lcPlayer) << "libass init:" << timer.elapsed()
+                    << "ms off the startup path";
+  if (m_onReady)
+    m_onReady();
+}
+
+void AssEngine::release() {
+  if (m_thread.joinable())
+    m_thread.join();
+  m_ready = false;
+  if (m_renderer) {
+    ass_renderer_done(m_renderer);
+    m_renderer = nullptr;
+  }
+  if (m_library) {
+    ass_library_done(m_library);
+    m_library = nullptr;
+  }
+}
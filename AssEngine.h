@@ -0,0 +1,39 @@
+#pragma once
+#include <ass/ass.h>
+#include <atomic>
+#include <functional>
+#include <thread>
+
+// libass 的延迟初始化
+// 大多数文件没有 ASS 字幕，启动时就创建渲染器、扫描字体是白白拖慢起播。
+// 找到 ASS 字幕时才创建 ASS_Library（很快，读取字幕文件要用），渲染器和字体
+// 在后台线程初始化，完成前 renderer() 返回空，字幕暂不显示，完成后调用就绪
+// 回调请界面重绘。
+class AssEngine {
+public:
+  ~AssEngine();
+
+  // 需要时创建 ASS_Library
+  ASS_Library *library();
+  // 字幕轨道读取完成后调用，在后台初始化渲染器（只做一次）
+  void startRenderer();
+  // 渲染器初始化完成后在后台线程调用；在 startRenderer 之前设置
+  void setReadyCallback(const std::function<void()> &ready);
+  // 渲染器，后台初始化完成前为空
+  ASS_Renderer *renderer() const { return m_ready ? m_renderer : nullptr; }
+
+  // 释放渲染器和库；之前必须停止所有使用渲染器的线程
+  void release();
+
+private:
+  static const int GLYPH_CACHE_MAX = 2000; // libass 缓存上限：字形条数
+  static const int BITMAP_CACHE_MB = 16;   // 位图缓存（MB）
+
+  void initRenderer();
+
+  ASS_Library *m_library = nullptr;
+  ASS_Renderer *m_renderer = nullptr;
+  std::atomic<bool> m_ready{false};
+  std::function<void()> m_onReady;
+  std::thread m_thread;
+};
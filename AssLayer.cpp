@@ -0,0 +1,135 @@
+#include "AssLayer.h"
+#include <QRect>
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+namespace {
+// x / 255，四舍五入
+inline uint32_t div255(uint32_t x) {
+  x += 128;
+  return (x + (x >> 8)) >> 8;
+}
+
+// 一行位图按颜色着色后混合到预乘 alpha 的 ARGB32 像素上：
+// k = mask * opacity / 255，dst = color * k / 255 + dst * (255 - k) / 255
+void blend_row(uint32_t *dst, const uint8_t *mask, int n, uint32_t r,
+               uint32_t g, uint32_t b, uint32_t opacity) {
+  int x = 0;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+  const uint8x8_t vo = vdup_n_u8(uint8_t(opacity));
+  const uint8x8_t vr = vdup_n_u8(uint8_t(r));
+  const uint8x8_t vg = vdup_n_u8(uint8_t(g));
+  const uint8x8_t vb = vdup_n_u8(uint8_t(b));
+  const uint8x8_t v255 = vdup_n_u8(255);
+  for (; x + 8 <= n; x += 8) {
+    uint16x8_t t = vmull_u8(vld1_u8(mask + x), vo);
+    uint8x8_t k = vraddhn_u16(t, vrshrq_n_u16(t, 8));
+    uint8x8_t inv = vmvn_u8(k);
+    // 小端 ARGB32 在内存中的顺序为 B、G、R、A
+    uint8x8x4_t px = vld4_u8(reinterpret_cast<uint8_t *>(dst + x));
+    uint16x8_t sb = vmlal_u8(vmull_u8(vb, k), px.val[0], inv);
+    uint16x8_t sg = vmlal_u8(vmull_u8(vg, k), px.val[1], inv);
+    uint16x8_t sr = vmlal_u8(vmull_u8(vr, k), px.val[2], inv);
+    uint16x8_t sa = vmlal_u8(vmull_u8(v255, k), px.val[3], inv);
+    px.val[0] = vraddhn_u16(sb, vrshrq_n_u16(sb, 8));
+    px.val[1] = vraddhn_u16(sg, vrshrq_n_u16(sg, 8));
+    px.val[2] = vraddhn_u16(sr, vrshrq_n_u16(sr, 8));
+    px.val[3] = vraddhn_u16(sa, vrshrq_n_u16(sa, 8));
+    vst4_u8(reinterpret_cast<uint8_t *>(dst + x), px);
+  }
+#endif
+  for (; x < n; ++x) {
+    uint32_t k = div255(mask[x] * opacity);
+    if (!k)
+      continue;
+    uint32_t inv = 255 - k;
+    uint32_t d = dst[x];
+    uint32_t a = div255(255 * k + (d >> 24) * inv);
+    uint32_t rr = div255(r * k + ((d >> 16) & 0xFF) * inv);
+    uint32_t gg = div255(g * k + ((d >> 8) & 0xFF) * inv);
+    uint32_t bb = div255(b * k + (d & 0xFF) * inv);
+    dst[x] = (a << 24) | (rr << 16) | (gg << 8) | bb;
+  }
+}
+} // namespace
+
+bool AssLayer::render(ASS_Renderer *renderer, ASS_Track *track, int width,
+                      int height, qint64 pts) {
+  if (!renderer || !track || width <= 0 || height <= 0)
+    return false;
+
+  // 尺寸或字幕轨道变化时一定重新合成
+  QSize frameSize(width, height);
+  if (frameSize != m_frameSize) {
+    ass_set_frame_size(renderer, width, height);
+    m_frameSize = frameSize;
+    m_valid = false;
+  }
+  if (track != m_track) {
+    m_track = track;
+    m_valid = false;
+  }
+
+  int detectChange = 0;
+  ASS_Image *images = ass_render_frame(renderer, track, pts, &detectChange);
+  m_changed = detectChange || !m_valid;
+  if (m_changed) {
+    compose(images);
+    m_valid = true;
+  }
+  return !m_image.isNull();
+}
+
+void AssLayer::compose(const ASS_Image *images) {
+  // 所有位图的外接矩形
+  QRect bounds;
+  for (const ASS_Image *img = images; img; img = img->next) {
+    if (img->w > 0 && img->h > 0)
+      bounds |= QRect(img->dst_x, img->dst_y, img->w, img->h);
+  }
+  bounds = bounds.intersected(QRect(QPoint(0, 0), m_frameSize));
+  if (bounds.isEmpty()) {
+    m_image = QImage();
+    return;
+  }
+
+  // 上一张图像仍被别处引用（例如预渲染环）时另建一张，避免写时复制
+  if (m_image.size() != bounds.size() || !m_image.isDetached())
+    m_image = QImage(bounds.size(), QImage::Format_ARGB32_Premultiplied);
+  if (m_image.isNull())
+    return;
+  m_image.fill(Qt::transparent);
+  m_pos = bounds.topLeft();
+
+  for (const ASS_Image *img = images; img; img = img->next) {
+    // color 为 RGBA，A 表示透明度（0 为不透明）
+    uint32_t opacity = 255 - (img->color & 0xFF);
+    if (!opacity)
+      continue;
+    uint32_t r = (img->color >> 24) & 0xFF;
+    uint32_t g = (img->color >> 16) & 0xFF;
+    uint32_t b = (img->color >> 8) & 0xFF;
+
+    QRect area = QRect(img->dst_x, img->dst_y, img->w, img->h)
+                     .intersected(bounds);
+    if (area.isEmpty())
+      continue;
+    int srcX = area.x() - img->dst_x;
+    int srcY = area.y() - img->dst_y;
+    for (int y = 0; y < area.height(); ++y) {
+      const uint8_t *mask =
+          img->bitmap + (srcY + y) * img->stride + srcX;
+      uint32_t *dst = reinterpret_cast<uint32_t *>(
+                          m_image.scanLine(area.y() - bounds.y() + y)) +
+                      (area.x() - bounds.x());
+      blend_row(dst, mask, area.width(), r, g, b, opacity);
+    }
+  }
+}
+
+void AssLayer::clear() {
+  m_track = nullptr;
+  m_valid = false;
+  m_image = QImage();
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <QImage>
+#include <QPoint>
+#include <QSize>
+#include <ass/ass.h>
+
+// ASS 字幕合成层的缓存
+// libass 的 detect_change 报告字幕没有变化时直接复用上一次合成的图像；有变化时
+// 把各个 ASS_Image 的单通道位图着色后直接混合进一张预乘 alpha 图像，图像只覆盖
+// 所有位图的外接矩形。着色与混合是逐行的向量化内核（ARM 上用 NEON，其他平台
+// 用等价的标量代码），不再为每个位图创建临时 QImage 和 QPainter。
+class AssLayer {
+public:
+  // 渲染 pts 时刻的字幕；没有字幕要显示时返回 false
+  bool render(ASS_Renderer *renderer, ASS_Track *track, int width, int height,
+              qint64 pts);
+
+  // 上一次 render 是否重新合成了图像（否则与之前相同）
+  bool changed() const { return m_changed; }
+
+  const QImage &image() const { return m_image; }
+  QPoint pos() const { return m_pos; } // 图像在画面中的位置
+
+  void clear();
+
+private:
+  void compose(const ASS_Image *images);
+
+  ASS_Track *m_track = nullptr;
+  QSize m_frameSize;
+  bool m_valid = false; // m_image 对应上一次渲染的结果
+  bool m_changed = false;
+  QImage m_image;
+  QPoint m_pos;
+};
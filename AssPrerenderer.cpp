@@ -0,0 +1,146 @@
+#include "AssPrerenderer.h"
+#include "PlayerLog.h"
+#include <algorithm>
+
+AssPrerenderer::~AssPrerenderer() { stop(); }
+
+void AssPrerenderer::start(ASS_Renderer *renderer, ASS_Track *track) {
+  stop();
+  m_renderer = renderer;
+  m_track = track;
+  m_layer.clear();
+  m_quit = false;
+  m_ready.clear();
+  m_next = -1;
+  m_missed = false;
+  m_size = QSize();
+  m_shown = Slot{0, 0, QImage(), QPoint()};
+  m_hits = m_misses = 0;
+  m_thread = std::thread(&AssPrerenderer::run, this);
+}
+
+void AssPrerenderer::stop() {
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_quit = true;
+  }
+  m_cond.notify_one();
+  if (!m_thread.joinable())
+    return;
+  m_thread.join();
+  if (m_hits + m_misses > 0)
+    qCDebug(lcPlayer) << "ASS prerender:" << m_misses << "misses of"
+                      << m_hits + m_misses << "frames";
+}
+
+bool AssPrerenderer::changedAt(qint64 pts) {
+  bool changed = true;
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    for (const Slot &slot : m_ready) {
+      if (slot.start <= pts && pts < slot.end) {
+        // 与上一项相同的渲染只延长有效区间，新的一项就是新的图像
+        changed = slot.start != m_shown.start ||
+                  slot.image.cacheKey() != m_shown.image.cacheKey();
+        // 不重画时也要让后台按播放位置继续提前渲染
+        m_target = std::max(m_target, pts);
+        break;
+      }
+    }
+  }
+  m_cond.notify_one();
+  return changed;
+}
+
+void AssPrerenderer::setReadyCallback(const std::function<void()> &ready) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_onReady = ready;
+}
+
+void AssPrerenderer::reset(qint64 pts, const QSize &size) {
+  ++m_generation;
+  m_ready.clear();
+  m_next = pts;
+  m_size = size;
+  m_shown = Slot{0, 0, QImage(), QPoint()};
+}
+
+bool AssPrerenderer::frame(qint64 pts, const QSize &size, QImage &image,
+                           QPoint &pos) {
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    // 尺寸变化、往回跳转或跳到预渲染范围之外时从新位置重新开始
+    if (size != m_size || m_next < 0 ||
+        (!m_ready.empty() && pts < m_ready.front().start) ||
+        (m_ready.empty() && pts < m_shown.start) ||
+        pts > m_next + LOOKAHEAD_MS) {
+      reset(pts, size);
+    }
+    m_target = pts;
+
+    // 丢弃已经过去的项
+    while (!m_ready.empty() && m_ready.front().end <= pts)
+      m_ready.pop_front();
+    // 后台落后于播放位置时直接从当前位置继续
+    if (m_ready.empty() && m_next < pts)
+      m_next = pts;
+
+    if (!m_ready.empty() && m_ready.front().start <= pts) {
+      ++m_hits;
+      m_shown = m_ready.front();
+      m_missed = false;
+    } else {
+      ++m_misses;
+      m_missed = true;
+    }
+    image = m_shown.image;
+    pos = m_shown.pos;
+  }
+  m_cond.notify_one();
+  return !image.isNull();
+}
+
+void AssPrerenderer::run() {
+  std::unique_lock<std::mutex> lk(m_mutex);
+  while (true) {
+    m_cond.wait(lk, [this] {
+      return m_quit ||
+             (m_next >= 0 && int(m_ready.size()) < RING_SIZE &&
+              m_next < m_target + LOOKAHEAD_MS);
+    });
+    if (m_quit)
+      break;
+    qint64 pts = m_next;
+    QSize size = m_size;
+    quint64 generation = m_generation;
+    lk.unlock();
+
+    bool visible = m_layer.render(m_renderer, m_track, size.width(),
+                                  size.height(), pts);
+
+    lk.lock();
+    if (generation != m_generation)
+      continue;
+    if (!m_layer.changed() && !m_ready.empty() &&
+        m_ready.back().end == pts) {
+      // 与上一项相同，延长其有效区间
+      m_ready.back().end = pts + STEP_MS;
+    } else {
+      m_ready.push_back(Slot{pts, pts + STEP_MS,
+                             visible ? m_layer.image() : QImage(),
+                             m_layer.pos()});
+    }
+    m_next = std::max(m_next, pts + STEP_MS);
+
+    // 补上了最近一次未命中的位置：通知界面重绘，否则要等到下一次字幕变化
+    const Slot &last = m_ready.back();
+    if (m_missed && m_onReady && last.start <= m_target &&
+        m_target < last.end) {
+      m_missed = false;
+      std::function<void()> ready = m_onReady;
+      lk.unlock();
+      ready();
+      lk.lock();
+    }
+  }
+}
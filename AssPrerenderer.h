@@ -0,0 +1,74 @@
+#pragma once
+#include <QImage>
+#include <QPoint>
+#include <QSize>
+#include <ass/ass.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "AssLayer.h"
+
+// ASS 字幕的后台预渲染
+// 特效多的 ASS 字幕（卡拉 OK、\t 动画）在我们的 CPU 上一次 ass_render_frame
+// 要几十毫秒，放在绘制里会卡住界面。后台线程按 STEP_MS 的间隔渲染播放位置之后
+// 的字幕，放进一个小的就绪环；libass 报告没有变化时只延长上一项的有效区间，
+// 静止的字幕只占一项。绘制时按时间戳取就绪的图像，没赶上的记为未命中，
+// 暂时沿用上一次显示的图像，后台补上未命中的位置后调用就绪回调请界面重绘。
+// 启动后 ASS_Renderer 只由后台线程使用。
+class AssPrerenderer {
+public:
+  ~AssPrerenderer();
+
+  void start(ASS_Renderer *renderer, ASS_Track *track);
+  void stop();
+  bool running() const { return m_thread.joinable(); }
+  ASS_Track *track() const { return m_track; }
+
+  // 取 pts 时刻的字幕图像，同时告诉后台当前播放位置；没有字幕时返回 false
+  bool frame(qint64 pts, const QSize &size, QImage &image, QPoint &pos);
+
+  // pts 时刻就绪的图像是否与上次显示的不同，同时推进后台的渲染位置；没有
+  // 覆盖 pts 的项时返回 true，由下一次绘制处理跳转或未命中
+  bool changedAt(qint64 pts);
+
+  // 未命中的播放位置渲染好后在后台线程调用
+  void setReadyCallback(const std::function<void()> &ready);
+
+private:
+  static const int STEP_MS = 33;       // 渲染间隔
+  static const int RING_SIZE = 8;      // 就绪环容量
+  static const int LOOKAHEAD_MS = 500; // 最多提前渲染的时长
+
+  struct Slot {
+    qint64 start; // 有效区间 [start, end)
+    qint64 end;
+    QImage image;
+    QPoint pos;
+  };
+
+  void run();
+  void reset(qint64 pts, const QSize &size);
+
+  ASS_Renderer *m_renderer = nullptr;
+  ASS_Track *m_track = nullptr;
+  AssLayer m_layer; // 只在后台线程使用
+
+  std::thread m_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  bool m_quit = false;
+  std::deque<Slot> m_ready;
+  quint64 m_generation = 0; // 跳转或尺寸变化时加一，丢弃进行中的渲染
+  qint64 m_next = -1;       // 下一个要渲染的时间戳，-1 表示还没有播放位置
+  qint64 m_target = 0;      // 最近一次绘制的播放位置
+  bool m_missed = false;    // 最近一次绘制未命中，等待补上
+  std::function<void()> m_onReady;
+  QSize m_size;
+  Slot m_shown{0, 0, QImage(), QPoint()}; // 上一次显示的图像，未命中时沿用
+
+  qint64 m_hits = 0;
+  qint64 m_misses = 0;
+};
@@ -0,0 +1,252 @@
+#include "AudioSeekIndex.h"
+#include "MediaCache.h"
+#include "PlayerLog.h"
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSaveFile>
+#include <QtDebug>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+const quint32 INDEX_MAGIC = 0x41534958; // "ASIX"
+const quint32 INDEX_VERSION = 1;
+const qint64 INDEX_HEADER_BYTES = 5 * 4; // magic、版本、采样率、每帧采样、帧数
+const quint32 MAX_FRAMES = 1u << 24; // 帧数上限（64 MB 索引，MP3 约五天时长）
+} // namespace
+
+AudioSeekIndex::~AudioSeekIndex() { stop(); }
+
+bool AudioSeekIndex::supports(const char *formatName) {
+  return formatName &&
+         (strcmp(formatName, "mp3") == 0 || strcmp(formatName, "aac") == 0);
+}
+
+void AudioSeekIndex::start(const QString &path, const char *formatName,
+                           std::function<void(qint64)> onReady) {
+  stop();
+  if (!supports(formatName))
+    return;
+  Kind kind = strcmp(formatName, "mp3") == 0 ? Mp3 : Adts;
+  m_stop = false;
+  m_thread = std::thread(&AudioSeekIndex::run, this, path, kind, onReady);
+}
+
+void AudioSeekIndex::stop() {
+  m_stop = true;
+  if (m_thread.joinable())
+    m_thread.join();
+  m_ready = false;
+  m_offsets.clear();
+  m_sampleRate = 0;
+  m_samplesPerFrame = 0;
+}
+
+qint64 AudioSeekIndex::durationMs() const {
+  if (!m_sampleRate)
+    return 0;
+  return qint64(m_offsets.size()) * m_samplesPerFrame * 1000 / m_sampleRate;
+}
+
+bool AudioSeekIndex::offsetFor(qint64 ms, int prerollFrames,
+                               qint64 &offset) const {
+  if (!m_ready || m_offsets.empty() || ms < 0)
+    return false;
+  qint64 frame = ms * m_sampleRate / (1000LL * m_samplesPerFrame);
+  if (frame >= qint64(m_offsets.size()))
+    return false;
+  offset = m_offsets[std::max<qint64>(0, frame - prerollFrames)];
+  return true;
+}
+
+qint64 AudioSeekIndex::sampleAt(qint64 offset) const {
+  if (!m_ready || m_offsets.empty() || offset < m_offsets.front())
+    return -1;
+  // 解复用器给出的包位置可能略偏，取不晚于它的最后一帧
+  auto it = std::upper_bound(m_offsets.begin(), m_offsets.end(), offset);
+  return qint64(it - m_offsets.begin() - 1) * m_samplesPerFrame;
+}
+
+void AudioSeekIndex::run(const QString &path, Kind kind,
+                         std::function<void(qint64)> onReady) {
+  MediaCache::setBackgroundPriority();
+  QString cachePath = MediaCache::filePath(path, "seekidx");
+  QElapsedTimer timer;
+  timer.start();
+
+  bool cached = load(cachePath);
+  if (!cached && !scan(path, kind))
+    return;
+  m_ready = true;
+  qCDebug(lcPlayer) << "Seek index:" << m_offsets.size() << "frames,"
+                    << durationMs() << "ms,"
+                    << (cached ? "loaded from cache" : "scanned") << "in"
+                    << timer.elapsed() << "ms";
+
+  if (cached) {
+    MediaCache::touch(cachePath);
+  } else {
+    save(cachePath);
+    MediaCache::trim();
+  }
+  if (onReady)
+    onReady(durationMs());
+}
+
+bool AudioSeekIndex::scan(const QString &path, Kind kind) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly) || file.size() > 0xFFFFFFFFLL)
+    return false;
+  const qint64 size = file.size();
+  const uchar *data = file.map(0, size);
+  if (!data)
+    return false;
+
+  auto parse = kind == Mp3 ? &AudioSeekIndex::parseMp3 : &AudioSeekIndex::parseAdts;
+  std::vector<quint32> offsets;
+  int sampleRate = 0;
+  int samples = 0;
+  bool synced = false;
+  qint64 pos = skipId3v2(data, size);
+
+  while (pos + 4 <= size && !m_stop) {
+    FrameInfo info;
+    bool ok = parse(data + pos, size - pos, info) &&
+              (!sampleRate ||
+               (info.sampleRate == sampleRate && info.samples == samples));
+    // 失步后要求下一帧帧头也有效才认定同步，避免把数据误判成帧头
+    if (ok && !synced && pos + info.length + 4 <= size) {
+      FrameInfo next;
+      ok = parse(data + pos + info.length, size - pos - info.length, next) &&
+           next.sampleRate == info.sampleRate && next.samples == info.samples;
+    }
+    if (!ok) {
+      // 文件尾部的 ID3v1 / APE 标签
+      if (synced && (memcmp(data + pos, "TAG", 3) == 0 ||
+                     (pos + 8 <= size && memcmp(data + pos, "APETAGEX", 8) == 0)))
+        break;
+      synced = false;
+      ++pos;
+      continue;
+    }
+
+    // MP3 首帧可能是 Xing/Info/VBRI 信息帧，解复用器会跳过它，不计入时间
+    bool skip = kind == Mp3 && offsets.empty() && !sampleRate &&
+                isVbrHeaderFrame(data + pos, size - pos);
+    sampleRate = info.sampleRate;
+    samples = info.samples;
+    synced = true;
+    if (!skip)
+      offsets.push_back(quint32(pos));
+    pos += info.length;
+  }
+  file.unmap(const_cast<uchar *>(data));
+
+  if (m_stop || offsets.empty())
+    return false;
+  m_sampleRate = sampleRate;
+  m_samplesPerFrame = samples;
+  m_offsets.swap(offsets);
+  return true;
+}
+
+bool AudioSeekIndex::load(const QString &cachePath) {
+  QFile file(cachePath);
+  if (!file.open(QIODevice::ReadOnly))
+    return false;
+  QDataStream in(&file);
+  quint32 magic = 0, version = 0, count = 0;
+  int sampleRate = 0, samples = 0;
+  in >> magic >> version >> sampleRate >> samples >> count;
+  if (magic != INDEX_MAGIC || version != INDEX_VERSION || sampleRate <= 0 ||
+      samples <= 0 || count == 0 || count > MAX_FRAMES)
+    return false;
+  // 帧数必须与文件剩余长度一致，截断或损坏的缓存直接丢弃，不按它分配内存
+  if (file.size() - INDEX_HEADER_BYTES !=
+      qint64(count) * qint64(sizeof(quint32)))
+    return false;
+  std::vector<quint32> offsets(count);
+  int bytes = int(count * sizeof(quint32));
+  if (in.readRawData(reinterpret_cast<char *>(offsets.data()), bytes) != bytes)
+    return false;
+  m_sampleRate = sampleRate;
+  m_samplesPerFrame = samples;
+  m_offsets.swap(offsets);
+  return true;
+}
+
+void AudioSeekIndex::save(const QString &cachePath) const {
+  QSaveFile file(cachePath);
+  if (!file.open(QIODevice::WriteOnly))
+    return;
+  QDataStream out(&file);
+  out << INDEX_MAGIC << INDEX_VERSION << m_sampleRate << m_samplesPerFrame
+      << quint32(m_offsets.size());
+  out.writeRawData(reinterpret_cast<const char *>(m_offsets.data()),
+                   int(m_offsets.size() * sizeof(quint32)));
+  if (!file.commit())
+    qWarning() << "Seek index: failed to write cache" << cachePath;
+}
+
+bool AudioSeekIndex::parseMp3(const uchar *p, qint64 avail, FrameInfo &info) {
+  static const int bitratesV1[16] = {0,   32,  40,  48,  56,  64,  80,  96,
+                                     112, 128, 160, 192, 224, 256, 320, 0};
+  static const int bitratesV2[16] = {0,  8,  16, 24,  32,  40,  48,  56,
+                                     64, 80, 96, 112, 128, 144, 160, 0};
+  static const int sampleRates[3] = {44100, 48000, 32000};
+  if (avail < 4 || p[0] != 0xFF || (p[1] & 0xE0) != 0xE0)
+    return false;
+  int version = (p[1] >> 3) & 3; // 3: MPEG1, 2: MPEG2, 0: MPEG2.5
+  int layer = (p[1] >> 1) & 3;   // 1: Layer III
+  int bitrateIndex = p[2] >> 4;
+  int rateIndex = (p[2] >> 2) & 3;
+  int padding = (p[2] >> 1) & 1;
+  if (version == 1 || layer != 1 || rateIndex == 3)
+    return false;
+  int bitrate = (version == 3 ? bitratesV1 : bitratesV2)[bitrateIndex];
+  if (!bitrate) // 自由格式或非法码率
+    return false;
+  info.sampleRate = sampleRates[rateIndex] >> (version == 3 ? 0 : version == 2 ? 1 : 2);
+  info.samples = version == 3 ? 1152 : 576;
+  info.length = (version == 3 ? 144 : 72) * bitrate * 1000 / info.sampleRate + padding;
+  return info.length > 4;
+}
+
+bool AudioSeekIndex::parseAdts(const uchar *p, qint64 avail, FrameInfo &info) {
+  static const int sampleRates[13] = {96000, 88200, 64000, 48000, 44100,
+                                      32000, 24000, 22050, 16000, 12000,
+                                      11025, 8000,  7350};
+  if (avail < 7 || p[0] != 0xFF || (p[1] & 0xF6) != 0xF0)
+    return false;
+  int rateIndex = (p[2] >> 2) & 0xF;
+  if (rateIndex >= 13)
+    return false;
+  info.sampleRate = sampleRates[rateIndex];
+  info.length = ((p[3] & 3) << 11) | (p[4] << 3) | (p[5] >> 5);
+  info.samples = 1024 * ((p[6] & 3) + 1);
+  return info.length > 7;
+}
+
+bool AudioSeekIndex::isVbrHeaderFrame(const uchar *p, qint64 avail) {
+  int version = (p[1] >> 3) & 3;
+  bool mono = (p[3] >> 6) == 3;
+  // 信息帧标记位于边信息之后，VBRI 固定在帧头后 32 字节
+  qint64 xing = version == 3 ? (mono ? 21 : 36) : (mono ? 13 : 21);
+  if (avail >= xing + 4 && (memcmp(p + xing, "Xing", 4) == 0 ||
+                            memcmp(p + xing, "Info", 4) == 0))
+    return true;
+  return avail >= 40 && memcmp(p + 36, "VBRI", 4) == 0;
+}
+
+qint64 AudioSeekIndex::skipId3v2(const uchar *data, qint64 size) {
+  qint64 pos = 0;
+  while (pos + 10 <= size && memcmp(data + pos, "ID3", 3) == 0) {
+    // 标签大小为 4 字节 syncsafe 整数，不含 10 字节头；带尾部时再加 10 字节
+    qint64 tagSize = (qint64(data[pos + 6] & 0x7F) << 21) |
+                     ((data[pos + 7] & 0x7F) << 14) |
+                     ((data[pos + 8] & 0x7F) << 7) | (data[pos + 9] & 0x7F);
+    pos += 10 + tagSize + ((data[pos + 5] & 0x10) ? 10 : 0);
+  }
+  return std::min(pos, size);
+}
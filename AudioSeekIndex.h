@@ -0,0 +1,61 @@
+#pragma once
+#include <QString>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// MP3 / ADTS AAC 裸流的精确跳转索引
+// 没有 Xing/VBRI 目录的 VBR MP3 和 ADTS 流只能按码率估算字节位置跳转，
+// 误差可达数秒。这里在后台以低 I/O 优先级逐帧扫描帧头，记录每一帧的文件偏移，
+// 帧号乘以每帧采样数即为精确时间；结果缓存到磁盘，下次打开直接加载。
+class AudioSeekIndex {
+public:
+  AudioSeekIndex() = default;
+  ~AudioSeekIndex();
+
+  // formatName 为 AVInputFormat::name，不支持的格式返回 false
+  static bool supports(const char *formatName);
+
+  // 在后台加载或建立索引，完成后以精确时长（ms）回调（在后台线程中调用）
+  void start(const QString &path, const char *formatName,
+             std::function<void(qint64)> onReady);
+  void stop();
+
+  // 以下查询只在 ready() 之后有效，索引建立完成后不再改变
+  bool ready() const { return m_ready; }
+  int sampleRate() const { return m_sampleRate; }
+  int samplesPerFrame() const { return m_samplesPerFrame; }
+  qint64 durationMs() const;
+
+  // 包含 ms 的帧往前 prerollFrames 帧的文件偏移（MP3 需要前几帧补足位储备）
+  bool offsetFor(qint64 ms, int prerollFrames, qint64 &offset) const;
+
+  // 文件偏移所在帧的起始采样序号，不在索引范围内返回 -1
+  qint64 sampleAt(qint64 offset) const;
+
+private:
+  enum Kind { Mp3, Adts };
+  struct FrameInfo {
+    int length;
+    int sampleRate;
+    int samples;
+  };
+
+  void run(const QString &path, Kind kind, std::function<void(qint64)> onReady);
+  bool scan(const QString &path, Kind kind);
+  bool load(const QString &cachePath);
+  void save(const QString &cachePath) const;
+
+  static bool parseMp3(const uchar *p, qint64 avail, FrameInfo &info);
+  static bool parseAdts(const uchar *p, qint64 avail, FrameInfo &info);
+  static bool isVbrHeaderFrame(const uchar *p, qint64 avail);
+  static qint64 skipId3v2(const uchar *data, qint64 size);
+
+  std::thread m_thread;
+  std::atomic<bool> m_stop{false};
+  std::atomic<bool> m_ready{false};
+  int m_sampleRate = 0;
+  int m_samplesPerFrame = 0;
+  std::vector<quint32> m_offsets; // 每一帧帧头的文件偏移
+};
@@ -0,0 +1,87 @@
+#include "DecodeQualityController.h"
+#include "PlayerLog.h"
+#include <algorithm>
+
+void DecodeQualityController::reset() {
+  m_level = Full;
+  clearWindow();
+}
+
+void DecodeQualityController::clearWindow() {
+  m_window.clear();
+  m_sinceChange = 0;
+}
+
+bool DecodeQualityController::report(qint64 lateMs, int frameIntervalMs) {
+  m_window.push_back(lateMs);
+  if (int(m_window.size()) > WINDOW)
+    m_window.pop_front();
+  if (++m_sinceChange < COOLDOWN || int(m_window.size()) < WINDOW)
+    return false;
+
+  int late = 0;
+  qint64 worst = m_window.front();
+  for (qint64 v : m_window) {
+    if (v > frameIntervalMs)
+      ++late;
+    worst = std::max(worst, v);
+  }
+
+  Level current = m_level;
+  Level next = current;
+  // 超过四分之一的帧迟到一个帧间隔以上时降级；
+  // 整个窗口里每一帧都至少提前半个帧间隔到达时才回升，避免来回抖动
+  if (late * 4 > WINDOW && current < HalfResolution)
+    next = Level(current + 1);
+  else if (worst < -frameIntervalMs / 2 && current > Full)
+    next = Level(current - 1);
+  if (next == current)
+    return false;
+
+  qCDebug(lcPlayer) << "Decode quality:" << levelName(current) << "->"
+                    << levelName(next) << "(" << late << "/" << WINDOW
+                    << "frames late, worst" << worst << "ms)";
+  m_level = next;
+  clearWindow();
+  return true;
+}
+
+const char *DecodeQualityController::levelName(Level level) {
+  switch (level) {
+  case Full:
+    return "full";
+  case SkipLoopFilter:
+    return "skip-loop-filter";
+  case SkipNonRef:
+    return "skip-nonref";
+  case FastScale:
+    return "fast-scale";
+  case HalfResolution:
+    return "half-resolution";
+  }
+  return "unknown";
+}
+
+void DecodeQualityController::apply(AVCodecContext *ctx,
+                                    AVDiscard skipFrameFloor) const {
+  Level level = m_level;
+  ctx->skip_loop_filter = level >= SkipLoopFilter ? AVDISCARD_ALL : AVDISCARD_DEFAULT;
+  ctx->skip_idct = level >= SkipNonRef ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
+  AVDiscard skipFrame = level >= SkipNonRef ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
+  ctx->skip_frame = std::max(skipFrame, skipFrameFloor);
+}
+
+int DecodeQualityController::swsFlags() const {
+  return m_level >= FastScale ? SWS_FAST_BILINEAR : SWS_BILINEAR;
+}
+
+void DecodeQualityController::outputSize(int width, int height, int &outWidth,
+                                         int &outHeight) const {
+  if (m_level >= HalfResolution) {
+    outWidth = std::max(2, (width / 2) & ~1);
+    outHeight = std::max(2, (height / 2) & ~1);
+  } else {
+    outWidth = width;
+    outHeight = height;
+  }
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "FFmpegUtils.h"
+#include <QtGlobal>
+#include <atomic>
+#include <deque>
+
+// 根据视频帧的迟到程度自适应降低解码质量
+// 维护最近若干帧的迟到量窗口，CPU 跟不上时逐级降级，余量恢复后逐级回升：
+//   SkipLoopFilter  跳过环路滤波
+//   SkipNonRef      非参考帧跳过 IDCT 并直接丢弃
+//   FastScale       转换 RGB 时改用快速双线性缩放
+//   HalfResolution  输出分辨率减半
+// 降级在解码前生效，省掉的正是跟不上时负担不起的那部分工作。
+class DecodeQualityController {
+public:
+  enum Level { Full, SkipLoopFilter, SkipNonRef, FastScale, HalfResolution };
+
+  void reset();
+  void clearWindow(); // 跳转后之前的迟到量不再有参考意义
+
+  // 记录一帧的迟到量（ms，负数表示提前到达），等级变化时返回 true
+  bool report(qint64 lateMs, int frameIntervalMs);
+
+  Level level() const { return m_level; }
+  static const char *levelName(Level level);
+
+  // 把当前等级应用到解码器；skipFrameFloor 为其他策略要求的最低丢帧等级
+  void apply(AVCodecContext *ctx, AVDiscard skipFrameFloor) const;
+  int swsFlags() const;
+  void outputSize(int width, int height, int &outWidth, int &outHeight) const;
+
+private:
+  static const int WINDOW = 32;   // 统计窗口（帧）
+  static const int COOLDOWN = 16; // 等级变化后至少观察的帧数
+
+  std::atomic<Level> m_level{Full};
+  std::deque<qint64> m_window;
+  int m_sinceChange = 0;
+};
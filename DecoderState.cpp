@@ -0,0 +1,75 @@
+#include "DecoderState.h"
+
+void DecoderState::reset() {
+  m_position = 0;
+  m_duration = 0;
+  m_eof = false;
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_audioTracks.clear();
+  m_videoTracks.clear();
+  ++m_tracksVersion;
+  m_error.clear();
+}
+
+bool DecoderState::touch() { return !m_dirty.exchange(true); }
+
+bool DecoderState::setPosition(qint64 ms) {
+  return m_position.exchange(ms) != ms && touch();
+}
+
+bool DecoderState::setDuration(qint64 ms) {
+  return m_duration.exchange(ms) != ms && touch();
+}
+
+bool DecoderState::setEof(bool eof) {
+  return m_eof.exchange(eof) != eof && touch();
+}
+
+bool DecoderState::setAudioTracks(const QStringList &names) {
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    if (m_audioTracks == names)
+      return false;
+    m_audioTracks = names;
+    ++m_tracksVersion;
+  }
+  return touch();
+}
+
+bool DecoderState::setVideoTracks(const QStringList &names) {
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    if (m_videoTracks == names)
+      return false;
+    m_videoTracks = names;
+    ++m_tracksVersion;
+  }
+  return touch();
+}
+
+bool DecoderState::setError(const QString &message) {
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_error = message;
+    ++m_errorVersion;
+  }
+  return touch();
+}
+
+void DecoderState::read(Snapshot &snap) {
+  // 先清标记再读取：读取期间的写入会再发一次通知，不会丢失
+  m_dirty = false;
+  snap.positionMs = m_position;
+  snap.durationMs = m_duration;
+  snap.eof = m_eof;
+  std::lock_guard<std::mutex> lk(m_mutex);
+  if (snap.tracksVersion != m_tracksVersion) {
+    snap.tracksVersion = m_tracksVersion;
+    snap.audioTracks = m_audioTracks;
+    snap.videoTracks = m_videoTracks;
+  }
+  if (snap.errorVersion != m_errorVersion) {
+    snap.errorVersion = m_errorVersion;
+    snap.error = m_error;
+  }
+}
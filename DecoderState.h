@@ -0,0 +1,52 @@
+#pragma once
+#include <QString>
+#include <QStringList>
+#include <atomic>
+#include <mutex>
+
+// 解码器发布给界面的状态
+// 两个解码线程随时写入，界面收到通知时读一份快照，不再为每个音频帧、视频帧
+// 排队一个位置事件。位置、时长这类数值用原子变量；轨道列表和错误消息很少变化，
+// 放在锁后面并带版本号，界面只在版本号变化时复制。状态变化且上一次通知已被
+// 读取时才需要通知界面，排队的通知最多一个。
+class DecoderState {
+public:
+  struct Snapshot {
+    qint64 positionMs = 0;
+    qint64 durationMs = 0;
+    bool eof = false;
+    quint64 tracksVersion = 0; // 与上次读取相同时下面两个列表不更新
+    QStringList audioTracks;
+    QStringList videoTracks;
+    quint64 errorVersion = 0; // 每条新错误加一
+    QString error;
+  };
+
+  void reset(); // 打开新文件时清空
+
+  // 以下写入函数返回 true 表示需要通知界面
+  bool setPosition(qint64 ms);
+  bool setDuration(qint64 ms);
+  bool setEof(bool eof);
+  bool setAudioTracks(const QStringList &names);
+  bool setVideoTracks(const QStringList &names);
+  bool setError(const QString &message);
+
+  // 读取快照并清除待通知标记；snap 保留上一次读取的内容以便比较版本号
+  void read(Snapshot &snap);
+
+private:
+  bool touch(); // 标记有变化，返回此前是否已读取
+
+  std::atomic<qint64> m_position{0};
+  std::atomic<qint64> m_duration{0};
+  std::atomic<bool> m_eof{false};
+  std::atomic<bool> m_dirty{false};
+
+  std::mutex m_mutex;
+  quint64 m_tracksVersion = 0;
+  QStringList m_audioTracks;
+  QStringList m_videoTracks;
+  quint64 m_errorVersion = 0;
+  QString m_error;
+};
@@ -1,34 +1,17 @@
 #include "FFMpegDecoder.h"
+#include "HttpCache.h"
+#include "MediaIO.h"
+#include "PlayerLog.h"
+#include <QElapsedTimer>
+#include <QFileInfo>
 #include <chrono>
 
-namespace {
-AVFramePtr make_avframe() { return AVFramePtr(av_frame_alloc()); }
-AVPacketPtr make_avpacket() { return AVPacketPtr(av_packet_alloc()); }
-AVCodecContextPtr make_avcodec_ctx(AVCodec *codec) {
-  return AVCodecContextPtr(avcodec_alloc_context3(codec));
-}
-
-// 查找解码器
-AVCodec *find_decoder(AVCodecID id, AVMediaType type) {
-  AVCodec *iter = av_codec_next(nullptr);
-  while (iter) {
-    if (iter->id == id && iter->decode != nullptr && iter->type == type) {
-      if (QString(iter->name).contains("rk", Qt::CaseInsensitive)) {
-        iter = av_codec_next(iter);
-        continue;
-      }
-      return iter;
-    }
-    iter = av_codec_next(iter);
-  }
-  return nullptr;
-}
-} // namespace
-
 // 构造函数，初始化 FFMpegDecoder 对象
 FFMpegDecoder::FFMpegDecoder(QObject *parent) : QObject(parent) {
   // 注册所有的 FFMpeg 组件
   av_register_all();
+  // 支持 http(s) / HLS 输入
+  avformat_network_init();
 
   // 注册 QSharedPointer<QImage> 类型，以便在信号槽中使用
   qRegisterMetaType<QSharedPointer<QImage>>("QSharedPointer<QImage>");
@@ -39,8 +22,11 @@ FFMpegDecoder::~FFMpegDecoder() { stop(); }
 void FFMpegDecoder::start(const QString &path) {
   // 停止解码器
   stop();
+  // 清空上一个文件发布的状态
+  m_state.reset();
   // 设置解码器路径
   m_path = path;
+  m_localFile = QFileInfo(path).isFile();
   // 设置停止标志为 false
   m_stop = false;
   // 设置暂停标志为 false
@@ -52,7 +38,25 @@ void FFMpegDecoder::start(const QString &path) {
   // 设置音频 seek 处理标志为 false
   m_audioSeekHandled = false;
   // 设置 eof 标志为 false
-  m_eof = false;
+  setEof(false);
+  // 清除 A-B 循环
+  m_loop.clear();
+  m_loopReplay = false;
+  // 清除逐帧步进/倒放状态
+  m_stepRequest = 0;
+  m_reverse = false;
+  m_gopDirty = false;
+  m_videoClockMs = 0;
+  m_exactDurationMs = 0;
+  m_variantAuto = true;
+  // 记录打开时间，用于统计到第一帧的耗时
+  m_probeCache.reset(path);
+  m_openTime = std::chrono::steady_clock::now();
+  m_firstFrameReported = false;
+  // 解码线程已停止，可以直接清空暂停预取
+  m_videoPrefill.clear();
+  m_audioPrefill.clear();
+  m_resumeReported = true;
   // 创建视频解码线程
   m_videoThread = std::thread(&FFMpegDecoder::videoDecodeLoop, this);
   // 创建音频解码线程
@@ -60,28 +64,73 @@ void FFMpegDecoder::start(const QString &path) {
 }
 
 void FFMpegDecoder::stop() {
-  m_stop = true;
-  m_eof = false;
+  {
+    // 在锁内置位，等待中的线程检查条件与睡眠之间不会漏掉这次通知
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_stop = true;
+  }
+  setEof(false);
   m_cond.notify_all();
   if (m_videoThread.joinable())
     m_videoThread.join();
   if (m_audioThread.joinable())
     m_audioThread.join();
+  if (m_mailbox.posted() > 0)
+    qCDebug(lcPlayer) << "Frame mailbox:" << m_mailbox.posted()
+                      << "frames posted," << m_mailbox.dropped()
+                      << "replaced before conversion";
+  // 回退缓冲区命中率按每次播放统计，停止时在默认开启的 info 级别报告
+  if (qint64 lookups = m_backBufferLookups.exchange(0)) {
+    qint64 hits = m_backBufferHits.exchange(0);
+    qCInfo(lcPlayer) << "Back buffer:" << hits << "of" << lookups
+                     << "backward seeks served from memory, hit rate"
+                     << qRound(100.0 * hits / lookups) << "%";
+  }
+  m_mailbox.clear();
+  m_gop.close();
+  m_seekIndex.stop();
+  m_proxy.stop();
+  m_probeCache.stop();
 }
 
 void FFMpegDecoder::seek(qint64 ms) {
-  m_seekTarget = ms;
-  m_seeking = true;
-  m_videoSeekHandled = false;
-  m_audioSeekHandled = false;
-  m_eof = false;
+  if (m_loop.active()) {
+    // 拖出循环区间即取消循环；区间内跳转只有从 A 点开始才记录缓存
+    if (ms < m_loop.start() || ms >= m_loop.end())
+      m_loop.clear();
+    else
+      m_loop.beginPass(ms <= m_loop.start());
+  }
+  m_loopReplay = false;
+  // 跳转后从新位置解码，不再需要回到步进停留的位置
+  m_stepRequest = 0;
+  m_reverse = false;
+  m_gopDirty = false;
+  requestSeek(ms);
+}
+
+void FFMpegDecoder::requestSeek(qint64 ms) {
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_seekTarget = ms;
+    m_videoSeekHandled = false;
+    m_audioSeekHandled = false;
+    m_seeking = true;
+  }
+  setEof(false);
   m_cond.notify_all();
 }
 
 void FFMpegDecoder::togglePause() {
   m_pause = !m_pause;
-  if (!m_pause)
-    m_cond.notify_all();
+  if (!m_pause) {
+    m_resumeTime = std::chrono::steady_clock::now();
+    m_resumeReported = false;
+    m_reverse = false;
+    resumeFromGopCache();
+  }
+  // 暂停时也要唤醒：跟随音频时钟等待的视频线程不会再等到时钟推进
+  m_cond.notify_all();
 }
 
 bool FFMpegDecoder::isPaused() const { return m_pause; }
@@ -95,117 +144,196 @@ void FFMpegDecoder::setAudioTrack(int index) {
     m_seeking = true;
     m_videoSeekHandled = false;
     m_audioSeekHandled = false;
-    m_eof = false;
+    setEof(false);
     m_cond.notify_all();
   }
 }
 
-int FFMpegDecoder::audioTrackCount() const {
-  return static_cast<int>(m_audioStreamIndices.size());
-}
-
 int FFMpegDecoder::currentAudioTrack() const { return m_audioTrackIndex; }
 
-QString FFMpegDecoder::audioTrackName(int idx) const {
-  if (idx < 0 || idx >= static_cast<int>(m_audioStreamNames.size()))
-    return QString();
-  return m_audioStreamNames[idx];
-}
-
 void FFMpegDecoder::setVideoTrack(int index) {
   std::lock_guard<std::mutex> lk(m_mutex);
   // 允许 index == -1，表示空轨道
   if (index < -1 || index >= static_cast<int>(m_videoStreamIndices.size()))
     return;
+  m_variantAuto = false;
   if (m_videoTrackIndex != index) {
     m_videoTrackIndex = index;
     if (index == -1) {
       m_seeking = true;
       m_videoSeekHandled = false;
       m_cond.notify_all();
-      emit frameReady(QSharedPointer<QImage>());
+      presentImage(QSharedPointer<QImage>());
     } else {
       m_seeking = true;
       m_videoSeekHandled = false;
       m_audioSeekHandled = false;
-      m_eof = false;
+      setEof(false);
       m_cond.notify_all();
     }
   }
 }
 
-int FFMpegDecoder::videoTrackCount() const {
-  return static_cast<int>(m_videoStreamIndices.size());
+bool FFMpegDecoder::hasVariants() const { return m_variants.active(); }
+
+bool FFMpegDecoder::variantAuto() const { return m_variantAuto; }
+
+void FFMpegDecoder::setVariantAuto(bool enable) { m_variantAuto = enable; }
+
+void FFMpegDecoder::probeAllStreams() {
+  if (m_localFile)
+    m_probeCache.probeInBackground(
+        [this](const AVFormatContext *fmtCtx) { publishProbedTracks(fmtCtx); });
 }
 
-int FFMpegDecoder::currentVideoTrack() const { return m_videoTrackIndex; }
+void FFMpegDecoder::publishProbedTracks(const AVFormatContext *fmtCtx) {
+  // 探测补全了未播放的流的编码参数，轨道名随之更新。探测缓存只用于本地文件，
+  // 不会有 HLS 变体
+  QStringList audio, video;
+  for (unsigned i = 0; i < fmtCtx->nb_streams; i++) {
+    const AVStream *stream = fmtCtx->streams[i];
+    if (stream->codecpar->codec_type == AVMEDIA_TYPE_AUDIO)
+      audio.append(trackName(stream, audio.size() + 1, true));
+    else if (stream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO)
+      video.append(trackName(stream, video.size() + 1, true));
+  }
+  publish(m_state.setAudioTracks(audio));
+  publish(m_state.setVideoTracks(video));
+}
 
-QString FFMpegDecoder::videoTrackName(int idx) const {
-  if (idx < 0 || idx >= static_cast<int>(m_videoStreamNames.size()))
-    return QString();
-  return m_videoStreamNames[idx];
+QString FFMpegDecoder::trackName(const AVStream *stream, int number,
+                                 bool withParams) {
+  QString name = QString("Track %1").arg(number);
+  AVDictionaryEntry *lang =
+      av_dict_get(stream->metadata, "language", nullptr, 0);
+  if (lang && lang->value)
+    name += QString(" [%1]").arg(lang->value);
+  if (!withParams)
+    return name;
+  // 编码参数在探测过该流后才完整，缺少的项不显示
+  const AVCodecParameters *par = stream->codecpar;
+  QStringList params;
+  if (par->codec_id != AV_CODEC_ID_NONE)
+    params.append(avcodec_get_name(par->codec_id));
+  if (par->codec_type == AVMEDIA_TYPE_AUDIO && par->channels > 0)
+    params.append(QString("%1ch").arg(par->channels));
+  if (par->codec_type == AVMEDIA_TYPE_VIDEO && par->width > 0 &&
+      par->height > 0)
+    params.append(QString("%1x%2").arg(par->width).arg(par->height));
+  if (!params.isEmpty())
+    name += QString(" (%1)").arg(params.join(", "));
+  return name;
 }
 
+int FFMpegDecoder::currentVideoTrack() const { return m_videoTrackIndex; }
+
 void FFMpegDecoder::videoDecodeLoop() {
+  bool reopened = false;
   while (!m_stop) {
-    // 打开输入文件
-    AVFormatContext *raw_fmt_ctx = nullptr;
-    AVDictionary *opts = nullptr;
-    av_dict_set(&opts, "probe_size", "1048576", 0);
-    av_dict_set(&opts, "analyzeduration", "1000000", 0);
-    if (avformat_open_input(&raw_fmt_ctx, m_path.toUtf8().constData(), nullptr,
-                            &opts) < 0) {
-      qWarning() << "Failed to open input file:" << m_path;
-      emit errorOccurred(tr("无法打开文件: %1").arg(m_path));
-      av_dict_free(&opts);
-      return;
+    // 代理文件就绪且当前轨道正是被转码的轨道时，视频改为从代理文件解码
+    int proxy_stream = -1;
+    {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      if (m_proxy.ready() && m_videoTrackIndex >= 0 &&
+          m_videoTrackIndex < static_cast<int>(m_videoStreamIndices.size()) &&
+          m_videoStreamIndices[m_videoTrackIndex] == m_proxy.sourceStream())
+        proxy_stream = m_proxy.sourceStream();
     }
-    av_dict_free(&opts);
-    AVFormatContextPtr fmt_ctx(raw_fmt_ctx);
-    if (avformat_find_stream_info(fmt_ctx.get(), nullptr) < 0) {
-      qWarning() << "Failed to get stream info";
-      emit errorOccurred(tr("无法获取媒体流信息"));
+    bool using_proxy = proxy_stream >= 0;
+    QString open_path = using_proxy ? m_proxy.proxyPath() : m_path;
+
+    // 打开输入文件
+    AVFormatContextPtr fmt_ctx;
+    if (!openInputFile(open_path, fmt_ctx, AVMEDIA_TYPE_VIDEO,
+                       using_proxy ? 0 : m_videoTrackIndex)) {
+      if (using_proxy) {
+        m_proxy.discard();
+        continue;
+      }
       return;
     }
-    // 获取所有视频流索引和名称
-    m_videoStreamIndices.clear();
-    m_videoStreamNames.clear();
-    for (unsigned i = 0; i < fmt_ctx->nb_streams; i++) {
-      AVCodecParameters *p = fmt_ctx->streams[i]->codecpar;
-      if (p->codec_type == AVMEDIA_TYPE_VIDEO) {
-        m_videoStreamIndices.push_back(i);
-        QString name = QString("Track %1").arg(m_videoStreamIndices.size());
-        if (fmt_ctx->streams[i]->metadata) {
-          AVDictionaryEntry *lang = av_dict_get(fmt_ctx->streams[i]->metadata,
-                                                "language", nullptr, 0);
-          if (lang && lang->value)
-            name += QString(" [%1]").arg(lang->value);
+    if (using_proxy)
+      qCDebug(lcPlayer) << "Video switched to proxy" << open_path;
+
+    // 代理文件只有一路视频，轨道列表和时长仍以原文件为准
+    if (!using_proxy) {
+      // 获取所有视频流索引和名称；HLS 变体的轨道名另标规格，不带编码参数
+      m_variants.init(fmt_ctx.get());
+      m_videoStreamIndices.clear();
+      QStringList names;
+      for (unsigned i = 0; i < fmt_ctx->nb_streams; i++) {
+        AVCodecParameters *p = fmt_ctx->streams[i]->codecpar;
+        if (p->codec_type == AVMEDIA_TYPE_VIDEO) {
+          m_videoStreamIndices.push_back(i);
+          names.append(trackName(fmt_ctx->streams[i],
+                                 int(m_videoStreamIndices.size()),
+                                 !m_variants.active()));
         }
-        m_videoStreamNames.push_back(name);
       }
-    }
-    if (m_videoTrackIndex >= static_cast<int>(m_videoStreamIndices.size()))
-      m_videoTrackIndex = m_videoStreamIndices.empty() ? -1 : 0;
+      if (m_videoTrackIndex >= static_cast<int>(m_videoStreamIndices.size()))
+        m_videoTrackIndex = m_videoStreamIndices.empty() ? -1 : 0;
 
-    // 简化为主循环：统一处理空轨道和视频轨道
-    qint64 duration_ms =
-        fmt_ctx->duration >= 0 ? fmt_ctx->duration / (AV_TIME_BASE / 1000) : 0;
-    emit durationChanged(duration_ms);
+      // HLS 多码率：轨道名标出变体规格，自动选择时先从最低码率起播
+      if (m_variants.active()) {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        for (size_t i = 0; i < m_videoStreamIndices.size(); i++) {
+          const VariantSelector::Variant *v =
+              m_variants.find(m_videoStreamIndices[i]);
+          if (!v)
+            continue;
+          names[int(i)] += QString(" (%1x%2 %3 kbps)")
+                               .arg(v->width)
+                               .arg(v->height)
+                               .arg(v->bitrate / 1000);
+          if (m_variantAuto && !reopened && v->stream == m_variants.lowest() &&
+              m_videoTrackIndex != -1)
+            m_videoTrackIndex = int(i);
+        }
+      }
+      publish(m_state.setVideoTracks(names));
+
+      // 简化为主循环：统一处理空轨道和视频轨道
+      qint64 duration_ms = fmt_ctx->duration >= 0
+                               ? fmt_ctx->duration / (AV_TIME_BASE / 1000)
+                               : 0;
+      // 跳转索引已建立时使用精确时长，而不是按码率估算的值
+      if (m_exactDurationMs > 0)
+        duration_ms = m_exactDurationMs;
+      publish(m_state.setDuration(duration_ms));
+    }
 
     // 资源初始化（移出循环）
     AVCodec *vcodec = nullptr;
     AVCodecContextPtr vctx;
-    int vwidth = 0, vheight = 0;
     AVRational vtime_base = {0, 1};
-    int sws_src_pix_fmt = -1;
-    SwsContext *sws_ctx = nullptr;
-    int rgb_stride = 0;
-    uint8_t *rgb_buf = nullptr;
-    int rgb_buf_size = 0;
+    double content_fps = 0;
+    AVDiscard skip_floor = AVDISCARD_DEFAULT; // 关键帧模式/倍速抽帧要求的丢帧下限
+    int codec_stream = -1; // vctx 对应的流
+    bool resync = reopened; // 重开文件或解码器后需从当前播放位置继续
+    reopened = true;
+    FrameConverter converter; // A-B 循环录制时在本线程转换
     AVPacketPtr pkt = make_avpacket();
     AVFramePtr frame = make_avframe();
+    PacketBackBuffer backBuffer(VIDEO_BACK_BUFFER_BYTES);
     using clock = std::chrono::steady_clock;
     clock::time_point playback_start_time = clock::now();
+    bool keyframeMode = false; // 当前是否只解码关键帧
+    int loopReplayIdx = -1;    // A-B 循环缓存重放位置
+    double decode_ms = 0;      // 下一个显示帧累计的解码耗时
+    // HLS 变体切换：等待中的目标流，以及排空旧解码器期间暂存的新变体首个关键帧
+    int pending_variant = -1;
+    clock::time_point pending_since;
+    AVPacketPtr switch_pkt = make_avpacket();
+    auto cancel_switch = [&] {
+      if (pending_variant >= 0)
+        fmt_ctx->streams[pending_variant]->discard = AVDISCARD_ALL;
+      pending_variant = -1;
+      av_packet_unref(switch_pkt.get());
+    };
+    auto elapsed_ms = [](clock::time_point since) {
+      return std::chrono::duration<double, std::milli>(clock::now() - since)
+          .count();
+    };
 
     while (!m_stop) {
       // 获取当前视频轨道索引
@@ -216,97 +344,190 @@ void FFMpegDecoder::videoDecodeLoop() {
             m_videoTrackIndex < static_cast<int>(m_videoStreamIndices.size()))
           vid_idx = m_videoStreamIndices[m_videoTrackIndex];
       }
+      if (using_proxy) {
+        // 切换到其他轨道时回到原文件
+        if (vid_idx != proxy_stream)
+          break;
+        vid_idx = 0;
+      } else if (vid_idx >= 0 && m_proxy.ready() &&
+                 vid_idx == m_proxy.sourceStream()) {
+        break; // 代理转码完成，重新打开
+      }
 
-      // 处理空轨道
+      // 处理空轨道：清空画面后睡眠到跳转、换轨或停止。
+      // 播放位置由音频线程按音频时钟发布，这里不再定时推进
       if (vid_idx < 0) {
-        // 清空画面
-        emit frameReady(QSharedPointer<QImage>());
-
-        // 暂停或等待状态变化
-        if (m_pause) {
-          std::unique_lock<std::mutex> lk(m_mutex);
-          m_cond.wait(lk, [&] {
-            return m_stop || !m_pause || m_seeking || m_videoTrackIndex != -1;
-          });
-          if (m_stop)
-            break;
-        }
+        presentImage(QSharedPointer<QImage>());
+        std::unique_lock<std::mutex> lk(m_mutex);
+        m_cond.wait(lk, [&] {
+          return m_stop || (m_seeking && !m_videoSeekHandled) ||
+                 (m_videoTrackIndex >= 0 &&
+                  m_videoTrackIndex <
+                      static_cast<int>(m_videoStreamIndices.size()));
+        });
+        if (m_stop)
+          break;
 
         // 处理 seek
-        if (m_seeking) {
-          m_audioClockMs.store(m_seekTarget);
-          std::lock_guard<std::mutex> lk(m_mutex);
+        if (m_seeking && !m_videoSeekHandled) {
+          qint64 target = m_seekTarget;
+          m_audioClockMs.store(target);
           m_videoSeekHandled = true;
           if (m_audioSeekHandled)
             m_seeking = false;
-          continue;
+          lk.unlock();
+          m_cond.notify_all();
+          publish(m_state.setPosition(target));
         }
-
-        // 推进位置（基于音频时钟）
-        emit positionChanged(m_audioClockMs.load());
-        std::this_thread::sleep_for(std::chrono::milliseconds(40));
         continue;
       }
 
+      // 显示尺寸变化后 lowres 等级不同时重新打开解码器
+      if (vctx && m_displaySizeChanged.exchange(false)) {
+        AVCodecParameters *par = fmt_ctx->streams[vid_idx]->codecpar;
+        if (choose_lowres(vcodec, par->width, par->height, m_displayWidth,
+                          m_displayHeight) != vctx->lowres) {
+          vctx.reset();
+          resync = true;
+        }
+      }
+
       // 初始化/重置视频解码资源（如果轨道变化）
-      if (!vctx || vid_idx !=
-                       m_videoStreamIndices
-                           [m_videoTrackIndex]) { // 假设轨道变化时重新初始化
+      if (!vctx || vid_idx != codec_stream) {
         vcodec = find_decoder(fmt_ctx->streams[vid_idx]->codecpar->codec_id,
                               AVMEDIA_TYPE_VIDEO);
         if (!vcodec) {
           qWarning() << "Video decoder not found";
-          emit errorOccurred(tr("未找到视频解码器"));
+          publish(m_state.setError(tr("未找到视频解码器")));
           break;
         }
         vctx = make_avcodec_ctx(vcodec);
         if (!vctx) {
           qWarning() << "Failed to allocate video decoder context";
-          emit errorOccurred(tr("无法分配视频解码器上下文"));
+          publish(m_state.setError(tr("无法分配视频解码器上下文")));
           break;
         }
         if (avcodec_parameters_to_context(
                 vctx.get(), fmt_ctx->streams[vid_idx]->codecpar) < 0) {
           qWarning() << "Failed to copy video decoder parameters";
-          emit errorOccurred(tr("无法复制视频解码器参数"));
+          publish(m_state.setError(tr("无法复制视频解码器参数")));
           break;
         }
+        // 内容大于显示区域时让解码器直接输出 1/2、1/4 或 1/8 分辨率，
+        // 解码、转换和内存带宽一并节省；不支持 lowres 的解码器由 sws 缩放到显示尺寸
+        AVCodecParameters *par = fmt_ctx->streams[vid_idx]->codecpar;
+        vctx->lowres = choose_lowres(vcodec, par->width, par->height,
+                                     m_displayWidth, m_displayHeight);
+        if (vctx->lowres)
+          qCDebug(lcPlayer) << "Video lowres" << vctx->lowres << "for"
+                            << par->width << "x" << par->height << "on"
+                            << m_displayWidth.load() << "x"
+                            << m_displayHeight.load() << "display";
         if (avcodec_open2(vctx.get(), vcodec, nullptr) < 0) {
           qWarning() << "Failed to open video decoder";
-          emit errorOccurred(tr("无法打开视频解码器"));
+          publish(m_state.setError(tr("无法打开视频解码器")));
           break;
         }
-        vwidth = vctx->width;
-        vheight = vctx->height;
+        codec_stream = vid_idx;
+        select_stream(fmt_ctx.get(), vid_idx);
+        pending_variant = -1;
+        m_variants.switched(vid_idx);
+        decode_ms = 0;
         vtime_base = fmt_ctx->streams[vid_idx]->time_base;
-        if (sws_ctx)
-          sws_freeContext(sws_ctx);
-        sws_ctx = nullptr;
-        if (rgb_buf)
-          av_free(rgb_buf);
-        rgb_buf = nullptr;
-        rgb_buf_size = 0;
-        if (vwidth && vheight) {
-          rgb_buf_size =
-              av_image_get_buffer_size(AV_PIX_FMT_RGB24, vwidth, vheight, 1);
-          rgb_buf = (uint8_t *)av_malloc(rgb_buf_size);
+        keyframeMode = false; // 新解码器需要重新应用 skip_frame
+        skip_floor = AVDISCARD_DEFAULT;
+        m_quality.reset();
+        AVRational fr = fmt_ctx->streams[vid_idx]->avg_frame_rate;
+        if (!fr.num || !fr.den)
+          fr = vctx->framerate;
+        content_fps = fr.num && fr.den ? av_q2d(fr) : 0;
+        backBuffer.reset(vtime_base);
+        if (resync) {
+          // 新解码器没有参考帧，从当前播放位置所在的关键帧重新解码
+          resync = false;
+          m_videoPrefill.clear();
+          qint64 resumeMs = m_audioTrackIndex != -1 ? m_audioClockMs.load()
+                                                    : m_videoClockMs.load();
+          seekWithBackBuffer(fmt_ctx.get(), backBuffer, resumeMs, "video");
+        }
+        // 代理模式：较长的视频统计播放解码的吞吐，跟不上实时则在后台转码代理文件
+        if (ProxyTranscoder::enabled() && m_localFile && !using_proxy &&
+            m_proxy.sourceStream() != vid_idx &&
+            fmt_ctx->duration / 1000 >= PROXY_MIN_DURATION_MS) {
+          AVCodecParameters *par = fmt_ctx->streams[vid_idx]->codecpar;
+          m_proxy.open(m_path, vid_idx, par->width, par->height,
+                       m_displayWidth, m_displayHeight);
         }
       }
 
-      // 暂停处理
-      if (m_pause) {
+      // 逐帧步进/倒放：画面由 GOP 缓存提供，主解码位置保持不动
+      if ((m_stepRequest != 0 || m_reverse) && !m_seeking) {
+        // GOP 缓存总是读原文件
+        serveFromGopCache(using_proxy ? proxy_stream : vid_idx);
+        continue;
+      }
+
+      // 暂停处理（拖动预览时即使暂停也要解码关键帧）；
+      // 暂停后先继续解码到预取上限再睡眠，恢复时从预取的帧开始
+      bool prefilling = !keyframeMode && prefillWhilePaused(m_videoPrefill);
+      if (m_pause && !m_scrubbing && !prefilling) {
         std::unique_lock<std::mutex> lk(m_mutex);
-        m_cond.wait(lk, [&] { return m_stop || !m_pause || m_seeking; });
+        m_cond.wait(lk, [&] {
+          return m_stop || !m_pause || m_seeking || m_stepRequest != 0 ||
+                 m_reverse;
+        });
         if (m_stop)
           break;
         playback_start_time = clock::now();
+        if (m_stepRequest != 0 || m_reverse)
+          continue;
+      }
+
+      // 关键帧模式切换
+      bool wantKeyframeOnly = useKeyframeOnly();
+      if (wantKeyframeOnly != keyframeMode) {
+        keyframeMode = wantKeyframeOnly;
+        // 退出关键帧模式时参考帧已缺失，需在当前位置重新定位；
+        // 若已有 seek 待处理则交给下面的跳转逻辑
+        cancel_switch();
+        m_videoPrefill.clear();
+        if (!keyframeMode && !m_seeking) {
+          qint64 resumeMs =
+              m_audioTrackIndex != -1 ? m_audioClockMs.load() : m_videoClockMs.load();
+          seekWithBackBuffer(fmt_ctx.get(), backBuffer, resumeMs, "video");
+          avcodec_flush_buffers(vctx.get());
+          playback_start_time = clock::now();
+          av_packet_unref(pkt.get());
+          av_frame_unref(frame.get());
+          continue;
+        }
+      }
+
+      // 倍速抽帧：内容帧率 × 倍速超过可显示帧率时解码前丢弃非参考帧
+      AVDiscard want_floor =
+          keyframeMode ? AVDISCARD_NONKEY
+                       : m_decimator.update(content_fps, m_playbackSpeed.load());
+      if (want_floor != skip_floor) {
+        skip_floor = want_floor;
+        m_quality.apply(vctx.get(), skip_floor);
       }
 
       // 跳转处理
       if (m_seeking) {
-        int64_t ts = m_seekTarget * (AV_TIME_BASE / 1000);
-        av_seek_frame(fmt_ctx.get(), -1, ts, AVSEEK_FLAG_BACKWARD);
+        if (m_videoSeekHandled) {
+          // 本线程已处理，等待音频线程完成同一次 seek
+          std::unique_lock<std::mutex> lk(m_mutex);
+          m_cond.wait(lk, [&] {
+            return m_stop || !m_seeking || !m_videoSeekHandled;
+          });
+          continue;
+        }
+        cancel_switch();
+        m_videoPrefill.clear();
+        seekWithBackBuffer(fmt_ctx.get(), backBuffer, m_seekTarget, "video");
         avcodec_flush_buffers(vctx.get());
+        m_quality.clearWindow();
+        m_decimator.reset();
         playback_start_time = clock::now();
         av_packet_unref(pkt.get());
         av_frame_unref(frame.get());
@@ -316,36 +537,125 @@ void FFMpegDecoder::videoDecodeLoop() {
           if (m_audioSeekHandled)
             m_seeking = false;
         }
+        m_cond.notify_all();
+        continue;
+      }
+
+      // A-B 循环：从缓存重放视频帧，不读文件
+      if (m_loopReplay) {
+        replayLoopVideo(loopReplayIdx, m_audioTrackIndex != -1);
         continue;
       }
+      loopReplayIdx = -1;
+
+      // HLS 多码率：按解码余量和下载速率选择变体。目标流取消丢弃后 hls 解复用器
+      // 从当前时间所在的分片开始下载它，旧变体继续解码直到新变体的分片开头
+      if (m_variantAuto && !using_proxy && !keyframeMode && !m_pause &&
+          pending_variant < 0 && switch_pkt->size == 0) {
+        int want = m_variants.choose(vid_idx,
+                                     m_quality.level() >=
+                                         DecodeQualityController::SkipNonRef,
+                                     HttpCache::throughput());
+        if (want != vid_idx) {
+          pending_variant = want;
+          pending_since = clock::now();
+          fmt_ctx->streams[want]->discard = AVDISCARD_DEFAULT;
+        }
+      } else if (pending_variant >= 0 &&
+                 (!m_variantAuto || keyframeMode ||
+                  elapsed_ms(pending_since) > VARIANT_SWITCH_TIMEOUT_MS)) {
+        cancel_switch();
+      }
 
-      // 读取视频帧
-      if (av_read_frame(fmt_ctx.get(), pkt.get()) < 0) {
-        m_eof = true;
+      // 读取视频帧（有暂停预取的帧时不读包；切换变体时先取暂存的关键帧，
+      // 回退缓冲区重放中则优先取缓冲区）
+      bool from_prefill = !prefilling && !m_videoPrefill.empty();
+      bool switching = !from_prefill && switch_pkt->size > 0;
+      bool replayed = false;
+      if (switching)
+        av_packet_move_ref(pkt.get(), switch_pkt.get());
+      else if (!from_prefill)
+        replayed = backBuffer.next(pkt.get());
+      if (!from_prefill && !switching && !replayed &&
+          av_read_frame(fmt_ctx.get(), pkt.get()) < 0) {
+        if (m_loop.active()) {
+          onVideoLoopEnd(loopReplayIdx);
+          continue;
+        }
+        // 播放结束：睡眠到跳转、逐帧步进、倒放或停止
+        setEof(true);
         std::unique_lock<std::mutex> lk(m_mutex);
-        m_cond.wait_for(lk, std::chrono::milliseconds(50),
-                        [&] { return m_stop || m_seeking || m_eof == false; });
+        m_cond.wait(lk, [&] {
+          return m_stop || m_seeking || m_eof == false || m_stepRequest != 0 ||
+                 m_reverse;
+        });
         if (m_stop)
           break;
         if (m_seeking) {
-          m_eof = false;
+          setEof(false);
           continue;
         }
         continue;
       }
 
+      // 新变体的分片以关键帧开始：暂存该包，先以空包排空旧解码器，
+      // 缓冲在旧解码器里的帧照常显示，下一轮换成新变体的解码器
+      bool draining = false;
+      if (!from_prefill && pending_variant >= 0 &&
+          pkt->stream_index == pending_variant) {
+        if (!(pkt->flags & AV_PKT_FLAG_KEY)) {
+          av_packet_unref(pkt.get());
+          continue;
+        }
+        av_packet_move_ref(switch_pkt.get(), pkt.get());
+        draining = true;
+      }
+
       // 判断是否为视频流
-      if (pkt->stream_index != vid_idx) {
+      if (!from_prefill && !draining && pkt->stream_index != vid_idx) {
+        av_packet_unref(pkt.get());
+        continue;
+      }
+      if (!from_prefill && !replayed && !draining)
+        backBuffer.push(pkt.get());
+
+      // 关键帧模式下非关键帧包直接丢弃，不送入解码器
+      if (keyframeMode && !(pkt->flags & AV_PKT_FLAG_KEY)) {
         av_packet_unref(pkt.get());
         continue;
       }
 
       // 发送视频帧到解码器
-      avcodec_send_packet(vctx.get(), pkt.get());
+      clock::time_point decode_start = clock::now();
+      if (!from_prefill)
+        avcodec_send_packet(vctx.get(), pkt.get());
+      decode_ms += elapsed_ms(decode_start);
+      // 拖动预览只需要这一帧，立即排空解码器避免等待后续包
+      bool scrubbing = keyframeMode && m_scrubbing;
+      if (scrubbing)
+        avcodec_send_packet(vctx.get(), nullptr);
+      bool loopEnded = false;
+
+      bool prefilled_frame = false;
+      auto receive_frame = [&] {
+        // 恢复播放后先取暂停期间预取的帧
+        prefilled_frame = !prefilling && m_videoPrefill.pop(frame.get());
+        if (prefilled_frame)
+          return 0;
+        clock::time_point start = clock::now();
+        int ret = avcodec_receive_frame(vctx.get(), frame.get());
+        decode_ms += elapsed_ms(start);
+        return ret;
+      };
 
       // 接收解码后的视频帧
-      while (!m_stop && !m_seeking &&
-             avcodec_receive_frame(vctx.get(), frame.get()) == 0) {
+      while (!m_stop && !m_seeking && receive_frame() == 0) {
+        if (prefilling) {
+          // 暂停预取：存一份拷贝，恢复后按正常流程同步和显示
+          m_videoPrefill.push(frame.get());
+          av_frame_unref(frame.get());
+          continue;
+        }
         double speed = m_playbackSpeed.load();
 
         int64_t pts = frame->best_effort_timestamp;
@@ -354,6 +664,21 @@ void FFMpegDecoder::videoDecodeLoop() {
         if (pts == AV_NOPTS_VALUE)
           pts = 0;
         int64_t ms = pts * vtime_base.num * 1000LL / vtime_base.den;
+
+        // A-B 循环：A 点之前的帧不显示，到达 B 点结束本轮
+        if (m_loop.active() && !scrubbing) {
+          if (ms < m_loop.start())
+            continue;
+          if (ms >= m_loop.end()) {
+            loopEnded = true;
+            break;
+          }
+        }
+
+        // 倍速抽帧：不在显示节拍上的帧不做同步等待和格式转换
+        if (!scrubbing && !keyframeMode && !m_decimator.shouldPresent(ms))
+          continue;
+
         qint64 audioClock = m_audioClockMs.load();
         qint64 diff = ms - audioClock;
 
@@ -365,7 +690,22 @@ void FFMpegDecoder::videoDecodeLoop() {
         }
         int max_wait = frame_interval * 2;
 
-        if (hasAudio && audioClock > 0) {
+        // 统计迟到量，CPU 跟不上时降低后续帧的解码质量
+        if (hasAudio && audioClock > 0 && !keyframeMode && !scrubbing &&
+            m_quality.report(-diff, frame_interval))
+          m_quality.apply(vctx.get(), skip_floor);
+
+        if (scrubbing) {
+          // 拖动预览：立即显示，不做同步
+        } else if (keyframeMode && hasAudio) {
+          // 关键帧模式：等待音频时钟走到该关键帧，而不是把它当作超前帧丢弃
+          waitAudioClock([&] {
+            return m_stop || m_seeking || m_pause || !useKeyframeOnly() ||
+                   m_audioClockMs.load() >= ms;
+          });
+          if (m_stop || m_seeking || m_pause)
+            break;
+        } else if (hasAudio && audioClock > 0) {
           if (diff > frame_interval) {
             int waited = 0;
             if (diff > 20 && waited < max_wait && !m_stop && !m_pause &&
@@ -393,7 +733,7 @@ void FFMpegDecoder::videoDecodeLoop() {
           }
         }
 
-        if (!hasAudio) {
+        if (!hasAudio && !scrubbing) {
           static qint64 last_video_pts = 0;
           static auto last_wall_clock = clock::now();
           static float last_video_speed = 1.0f;
@@ -418,6 +758,11 @@ void FFMpegDecoder::videoDecodeLoop() {
                     now - last_wall_clock)
                     .count();
 
+            if (!keyframeMode &&
+                m_quality.report(qint64(elapsed - pts_diff / speed),
+                                 frame_interval))
+              m_quality.apply(vctx.get(), skip_floor);
+
             if (!m_stop && !m_seeking && !m_pause &&
                 elapsed < pts_diff / speed) {
               std::this_thread::sleep_for(std::chrono::milliseconds(
@@ -434,80 +779,103 @@ void FFMpegDecoder::videoDecodeLoop() {
         if (m_stop || m_seeking)
           break;
 
-        // 初始化 SwsContext
-        if (!sws_ctx || sws_src_pix_fmt != frame->format ||
-            frame->width != vwidth || frame->height != vheight) {
-          if (sws_ctx)
-            sws_freeContext(sws_ctx);
-          vwidth = frame->width;
-          vheight = frame->height;
-          rgb_stride = vwidth * 3;
-          int new_buf_size =
-              av_image_get_buffer_size(AV_PIX_FMT_RGB24, vwidth, vheight, 1);
-          if (new_buf_size != rgb_buf_size) {
-            if (rgb_buf)
-              av_free(rgb_buf);
-            rgb_buf = (uint8_t *)av_malloc(new_buf_size);
-            rgb_buf_size = new_buf_size;
-          }
-          sws_ctx = sws_getCachedContext(
-              nullptr, vwidth, vheight, (AVPixelFormat)frame->format, vwidth,
-              vheight, AV_PIX_FMT_RGB24, SWS_BILINEAR, nullptr, nullptr,
-              nullptr);
-          sws_src_pix_fmt = frame->format;
-          if (!sws_ctx)
-            continue;
+        // 正常速度下每个显示帧的解码耗时即变体选择、代理决策依据的 CPU 负载
+        if (!scrubbing && !keyframeMode && !prefilled_frame &&
+            !m_decimator.active()) {
+          m_variants.report(decode_ms, frame_interval);
+          m_proxy.report(decode_ms, frame_interval,
+                         m_quality.level() >=
+                             DecodeQualityController::SkipNonRef);
         }
-
-        if (!rgb_buf) {
-          rgb_buf_size =
-              av_image_get_buffer_size(AV_PIX_FMT_RGB24, vwidth, vheight, 1);
-          rgb_buf = (uint8_t *)av_malloc(rgb_buf_size);
-          if (!rgb_buf)
-            continue;
+        decode_ms = 0;
+
+        // 转换参数：直接缩放到显示尺寸，降级时可能改用快速缩放或再减半
+        int fit_width = 0, fit_height = 0, out_width = 0, out_height = 0;
+        fit_within(frame->width, frame->height, m_displayWidth, m_displayHeight,
+                   fit_width, fit_height);
+        m_quality.outputSize(fit_width, fit_height, out_width, out_height);
+        if (m_loop.active()) {
+          // A-B 循环首轮要把转换结果记录到区间缓存，在本线程立即转换
+          QSharedPointer<QImage> imgPtr = converter.convert(
+              frame.get(), out_width, out_height, m_quality.swsFlags());
+          m_loop.addVideo(ms, imgPtr);
+          presentImage(imgPtr);
+        } else if (m_mailbox.post(frame.get(), ms, out_width, out_height,
+                                  m_quality.swsFlags())) {
+          // 转换推迟到界面绘制时，界面来不及取走的帧直接被新帧替换
+          emit frameAvailable();
         }
+        publish(m_state.setPosition(ms));
+        m_videoClockMs = ms;
+        reportFirstFrame();
+        reportResumeFrame(prefilled_frame);
+      }
+      av_packet_unref(pkt.get());
 
-        // 转换格式
-        uint8_t *dst[1] = {rgb_buf};
-        int dst_linesize[1] = {rgb_stride};
-        sws_scale(sws_ctx, frame->data, frame->linesize, 0, vheight, dst,
-                  dst_linesize);
-
-        // 创建 QImage
-        struct RGBBufferDeleter {
-          void operator()(QImage *img) { delete img; }
-        };
-        QSharedPointer<QImage> imgPtr;
-        if (rgb_buf) {
-          QImage *rawImg = new QImage(
-              rgb_buf, vwidth, vheight, rgb_stride, QImage::Format_RGB888,
-              [](void *buf) { av_free(buf); }, rgb_buf);
-          if (!rawImg->isNull()) {
-            imgPtr = QSharedPointer<QImage>(rawImg, RGBBufferDeleter());
-            rgb_buf = nullptr;
-          } else {
-            delete rawImg;
-            QImage tempImg(rgb_buf, vwidth, vheight, rgb_stride,
-                           QImage::Format_RGB888);
-            imgPtr = QSharedPointer<QImage>(new QImage(tempImg.copy()));
-            av_free(rgb_buf);
-            rgb_buf = nullptr;
+      if (draining) {
+        // 旧解码器已排空，不能再送包，下一轮重新打开；
+        // 期间用户另选了轨道则以用户的选择为准
+        bool switched = false;
+        {
+          std::lock_guard<std::mutex> lk(m_mutex);
+          auto it = std::find(m_videoStreamIndices.begin(),
+                              m_videoStreamIndices.end(), pending_variant);
+          if (m_variantAuto && it != m_videoStreamIndices.end() &&
+              m_videoTrackIndex >= 0 &&
+              m_videoTrackIndex < static_cast<int>(m_videoStreamIndices.size()) &&
+              m_videoStreamIndices[m_videoTrackIndex] == vid_idx) {
+            m_videoTrackIndex = int(it - m_videoStreamIndices.begin());
+            switched = true;
           }
         }
-        emit frameReady(imgPtr);
-        emit positionChanged(ms);
+        if (switched) {
+          qCDebug(lcPlayer) << "HLS variant switched from stream" << vid_idx
+                            << "to" << pending_variant << "at"
+                            << m_videoClockMs.load() << "ms";
+        } else {
+          av_packet_unref(switch_pkt.get());
+          resync = true;
+        }
+        pending_variant = -1;
+        vctx.reset();
+      }
+
+      if (loopEnded)
+        onVideoLoopEnd(loopReplayIdx);
+
+      // 拖动预览：显示一帧后等待下一次拖动或结束拖动
+      if (scrubbing) {
+        std::unique_lock<std::mutex> lk(m_mutex);
+        m_cond.wait(lk, [&] { return m_stop || m_seeking || !m_scrubbing; });
       }
-      av_packet_unref(pkt.get());
     }
 
-    // 清理资源
-    if (rgb_buf)
-      av_free(rgb_buf);
-    if (sws_ctx)
-      sws_freeContext(sws_ctx);
   }
 }
 
+std::unique_ptr<FrameMailbox::Frame> FFMpegDecoder::takeFrame() {
+  return m_mailbox.take();
+}
+
+void FFMpegDecoder::readState(DecoderState::Snapshot &snap) {
+  m_state.read(snap);
+}
+
+void FFMpegDecoder::publish(bool changed) {
+  if (changed)
+    emit stateChanged();
+}
+
+void FFMpegDecoder::setEof(bool eof) {
+  m_eof = eof;
+  publish(m_state.setEof(eof));
+}
+
+void FFMpegDecoder::presentImage(const QSharedPointer<QImage> &img) {
+  m_mailbox.clear();
+  emit frameReady(img);
+}
+
 void FFMpegDecoder::setPlaybackSpeed(float speed) {
   // 限制播放速度范围在 0.25 - 4.0 之间
   float newSpeed = std::max(0.25f, std::min(speed, 4.0f));
@@ -516,52 +884,403 @@ void FFMpegDecoder::setPlaybackSpeed(float speed) {
   // 只有当速度真正变化时才更新和发送信号
   if (fabs(newSpeed - oldSpeed) > 0.01f) {
     m_playbackSpeed.store(newSpeed);
+    // 倍速跨过关键帧模式阈值时唤醒等待音频时钟的视频线程
+    m_cond.notify_all();
   }
 }
 
+void FFMpegDecoder::setKeyframeOnly(bool enable) {
+  m_keyframeOnly = enable;
+  m_cond.notify_all();
+}
+
+bool FFMpegDecoder::isKeyframeOnly() const { return useKeyframeOnly(); }
+
+void FFMpegDecoder::setDisplayRefreshRate(double hz) {
+  m_decimator.setDisplayRate(hz);
+}
+
+DecodeQualityController::Level FFMpegDecoder::decodeQuality() const {
+  return m_quality.level();
+}
+
+void FFMpegDecoder::beginScrub() {
+  m_scrubbing = true;
+  m_cond.notify_all();
+}
+
+void FFMpegDecoder::endScrub() {
+  // 调用方应先 seek 到松手位置，这样视频线程会直接在该位置恢复完整解码
+  m_scrubbing = false;
+  m_cond.notify_all();
+}
+
+void FFMpegDecoder::seekWithBackBuffer(AVFormatContext *fmtCtx,
+                                       PacketBackBuffer &backBuffer, qint64 ms,
+                                       const char *tag) {
+  bool hit = backBuffer.seek(ms);
+  qint64 lookups = ++m_backBufferLookups;
+  qint64 hits = hit ? ++m_backBufferHits : m_backBufferHits.load();
+  qCDebug(lcPlayer) << "Back-buffer" << tag << (hit ? "hit" : "miss") << "at"
+                    << ms << "ms, window" << backBuffer.startMs() << "-"
+                    << backBuffer.endMs() << "ms, hit rate" << hits << "/"
+                    << lookups;
+  if (hit)
+    return;
+
+  // 文件位置跳变后缓冲内容不再连续，必须清空
+  backBuffer.clear();
+  av_seek_frame(fmtCtx, -1, ms * (AV_TIME_BASE / 1000), AVSEEK_FLAG_BACKWARD);
+}
+
+void FFMpegDecoder::setLoopRegion(qint64 startMs, qint64 endMs) {
+  if (endMs - startMs < 200)
+    return;
+  m_loopReplay = false;
+  m_loop.reset(startMs, endMs);
+  // 从 A 点开始的第一轮会记录缓存
+  seek(startMs);
+}
+
+void FFMpegDecoder::clearLoopRegion() {
+  bool wasReplaying = m_loopReplay.exchange(false);
+  m_loop.clear();
+  // 缓存重放期间文件读取位置停在 B 点，需回到当前播放位置继续解码
+  if (wasReplaying)
+    requestSeek(m_loopReplayPos.load());
+  m_cond.notify_all();
+}
+
+bool FFMpegDecoder::hasLoopRegion() const { return m_loop.active(); }
+
+// 超出缓存上限的区间在到达 B 点后才回跳，回绕处有一次 seek 的间隙
+void FFMpegDecoder::seekToLoopStart() {
+  m_loop.beginPass(true);
+  requestSeek(m_loop.start());
+}
+
+bool FFMpegDecoder::clipToLoopRegion(qint64 &ms, QByteArray &pcm,
+                                     bool &reachedEnd) {
+  const int bytesPerSample =
+      OUT_CHANNELS * av_get_bytes_per_sample(OUT_SAMPLE_FMT);
+  const qint64 a = m_loop.start();
+  const qint64 b = m_loop.end();
+  if (ms >= b) {
+    reachedEnd = true;
+    pcm = QByteArray();
+    return true;
+  }
+
+  int samples = pcm.size() / bytesPerSample;
+  qint64 endMs = ms + samples * 1000LL / OUT_SAMPLE_RATE;
+  if (endMs <= a)
+    return false;
+
+  // 按采样裁剪到 [A, B)，使回绕点精确落在 A 点
+  int first = 0;
+  if (ms < a) {
+    first = int((a - ms) * OUT_SAMPLE_RATE / 1000);
+    ms = a;
+  }
+  int last = samples;
+  if (endMs > b) {
+    last = samples - int((endMs - b) * OUT_SAMPLE_RATE / 1000);
+    reachedEnd = true;
+  }
+  if (last <= first) {
+    pcm = QByteArray();
+    return true;
+  }
+  pcm = QByteArray::fromRawData(pcm.constData() + first * bytesPerSample,
+                                (last - first) * bytesPerSample);
+  return true;
+}
+
+void FFMpegDecoder::onAudioLoopEnd(int &replayIdx) {
+  m_loop.finishAudio();
+  // 视频线程通常同时到达 B 点，稍等它完成记录
+  bool cached = m_loop.audioReady() &&
+                (!hasVideoTrack() ||
+                 m_loop.waitVideoReady(std::chrono::milliseconds(200)));
+  if (cached) {
+    qCDebug(lcPlayer) << "A-B loop: replaying" << m_loop.start() << "-"
+                      << m_loop.end() << "ms from cache";
+    replayIdx = 0;
+    m_loopReplay = true;
+    m_cond.notify_all();
+  } else {
+    seekToLoopStart();
+  }
+}
+
+void FFMpegDecoder::onVideoLoopEnd(int &replayIdx) {
+  m_loop.finishVideo();
+  if (m_audioTrackIndex != -1) {
+    // 有音频时由音频线程决定重放还是回跳，这里停在 B 点等待
+    std::unique_lock<std::mutex> lk(m_mutex);
+    m_cond.wait(lk, [&] {
+      return m_stop || m_seeking || m_loopReplay || !m_loop.active();
+    });
+    return;
+  }
+  if (m_loop.videoReady()) {
+    replayIdx = -1;
+    m_loopReplay = true;
+  } else {
+    seekToLoopStart();
+  }
+}
+
+void FFMpegDecoder::replayLoopVideo(int &idx, bool followAudio) {
+  LoopRegionCache::VideoFrame f;
+  if (followAudio) {
+    // 跟随音频重放的时钟显示对应帧
+    qint64 clock = m_audioClockMs.load();
+    int cur = m_loop.videoIndexAt(clock);
+    if (cur >= 0 && cur != idx && m_loop.videoFrame(cur, f)) {
+      presentImage(f.image);
+      m_videoClockMs = f.ms;
+    }
+    idx = cur;
+    // 睡眠到音频线程推进时钟（暂停时一直等到恢复），不再定时轮询
+    waitAudioClock([&] {
+      return m_stop || m_seeking || !m_loopReplay ||
+             m_audioClockMs.load() != clock;
+    });
+    return;
+  }
+
+  // 无音频：按帧时间间隔自行推进，末尾回到第一帧
+  if (idx < 0 || !m_loop.videoFrame(idx, f)) {
+    idx = 0;
+    if (!m_loop.videoFrame(idx, f)) {
+      m_loopReplay = false;
+      seekToLoopStart();
+      return;
+    }
+  }
+  presentImage(f.image);
+  publish(m_state.setPosition(f.ms));
+  m_loopReplayPos = f.ms;
+  m_videoClockMs = f.ms;
+
+  LoopRegionCache::VideoFrame next;
+  qint64 gap = m_loop.videoFrame(idx + 1, next) ? next.ms - f.ms
+                                                : m_loop.end() - f.ms;
+  ++idx;
+  double speed = m_playbackSpeed.load();
+  std::unique_lock<std::mutex> lk(m_mutex);
+  m_cond.wait_for(lk, std::chrono::milliseconds(qint64(gap / speed)), [&] {
+    return m_stop || m_seeking || m_pause || !m_loopReplay;
+  });
+}
+
+void FFMpegDecoder::stepFrame(int direction) {
+  if (direction == 0)
+    return;
+  m_pause = true;
+  m_reverse = false;
+  m_stepRequest = direction > 0 ? 1 : -1;
+  m_cond.notify_all();
+}
+
+void FFMpegDecoder::setReversePlayback(bool enable) {
+  if (enable) {
+    m_pause = true; // 倒放期间音频静止
+    m_reverse = true;
+  } else if (m_reverse.exchange(false)) {
+    // 结束倒放后从当前画面位置正向播放
+    m_pause = false;
+    resumeFromGopCache();
+  }
+  m_cond.notify_all();
+}
+
+bool FFMpegDecoder::isReversePlayback() const { return m_reverse; }
+
+void FFMpegDecoder::setDisplaySize(int width, int height) {
+  // 两个 exchange 都要执行，不能短路，否则宽度变化时高度保持旧值
+  bool widthChanged = m_displayWidth.exchange(width) != width;
+  bool heightChanged = m_displayHeight.exchange(height) != height;
+  if (widthChanged || heightChanged)
+    m_displaySizeChanged = true;
+  m_gop.setTargetSize(width, height);
+}
+
+void FFMpegDecoder::resumeFromGopCache() {
+  if (m_gopDirty.exchange(false))
+    requestSeek(m_videoClockMs.load());
+}
+
+void FFMpegDecoder::serveFromGopCache(int streamIndex) {
+  if (!m_gop.isOpen() || m_gop.streamIndex() != streamIndex) {
+    AVIOInterruptCB interrupt = {&FFMpegDecoder::stopRequested, this};
+    if (!m_gop.open(m_path, streamIndex, &interrupt)) {
+      m_stepRequest = 0;
+      m_reverse = false;
+      return;
+    }
+  }
+
+  int step = m_stepRequest.exchange(0);
+  bool reverse = step == 0 && m_reverse;
+  qint64 cur = m_videoClockMs.load();
+  GopCache::Frame f;
+  bool found = step > 0 ? m_gop.frameAfter(cur, f, true)
+                        : m_gop.frameBefore(cur, f, true);
+  if (!found) {
+    // 倒放到达文件开头
+    if (reverse)
+      m_reverse = false;
+    return;
+  }
+
+  m_gopDirty = true;
+  m_videoClockMs = f.ms;
+  m_audioClockMs = f.ms;
+  presentImage(f.image);
+  publish(m_state.setPosition(f.ms));
+
+  if (reverse) {
+    // 按两帧的时间间隔倒序推进
+    qint64 gap = std::max<qint64>(10, std::min<qint64>(cur - f.ms, 200));
+    double speed = m_playbackSpeed.load();
+    std::unique_lock<std::mutex> lk(m_mutex);
+    m_cond.wait_for(lk, std::chrono::milliseconds(qint64(gap / speed)), [&] {
+      return m_stop || m_seeking || !m_reverse || m_stepRequest != 0;
+    });
+  }
+}
+
+void FFMpegDecoder::advanceAudioClock(qint64 ms) {
+  m_audioClockMs.store(ms);
+  // 只在有线程等待时钟时加锁通知，正常播放不为每个音频帧付出锁的开销
+  if (m_clockWaiters.load() > 0) {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_cond.notify_all();
+  }
+}
+
+void FFMpegDecoder::waitAudioClock(const std::function<bool()> &ready) {
+  std::unique_lock<std::mutex> lk(m_mutex);
+  ++m_clockWaiters;
+  m_cond.wait(lk, ready);
+  --m_clockWaiters;
+}
+
+int FFMpegDecoder::stopRequested(void *opaque) {
+  return static_cast<FFMpegDecoder *>(opaque)->m_stop ? 1 : 0;
+}
+
+bool FFMpegDecoder::hasVideoTrack() const {
+  return m_videoTrackIndex != -1 && !m_videoStreamIndices.empty();
+}
+
+bool FFMpegDecoder::useKeyframeOnly() const {
+  return m_keyframeOnly || m_scrubbing ||
+         m_playbackSpeed.load() >= KEYFRAME_ONLY_SPEED - 0.01f;
+}
+
 // ===== 音频解码循环：工具函数 =====
-bool FFMpegDecoder::openInputFile(AVFormatContextPtr &m_fmtCtx) {
+// 打开输入并获取流信息；原文件优先用探测缓存，代理文件打开失败时只记录日志。
+// 文件头已给出第 track 路 type 类型流的编码参数时跳过探测，其余流在用户打开
+// 轨道菜单时才在后台补全
+bool FFMpegDecoder::openInputFile(const QString &path,
+                                  AVFormatContextPtr &fmtCtx, AVMediaType type,
+                                  int track) {
+  const bool isSource = path == m_path;
+  // 探测缓存按文件大小和修改时间失效，只用于本地文件
+  const bool useProbeCache = isSource && m_localFile;
+  std::lock_guard<std::mutex> lk(m_openMutex);
+  QElapsedTimer timer;
+  timer.start();
+
   AVDictionary *opts = nullptr;
-  av_dict_set(&opts, "probe_size", "1048576", 0);
+  av_dict_set(&opts, "probesize", "1048576", 0);
   av_dict_set(&opts, "analyzeduration", "1000000", 0);
+  // 本地文件走 mmap + 后台预读、网络地址走磁盘缓存的自定义 I/O；
+  // 停止时中断阻塞的网络读取（网络缓存等待下载时检查该回调）
+  AVIOInterruptCB interrupt = {&FFMpegDecoder::stopRequested, this};
   AVFormatContext *raw_fmt_ctx = nullptr;
-
-  if (avformat_open_input(&raw_fmt_ctx, m_path.toUtf8().constData(), nullptr,
-                          &opts) < 0) {
-    qWarning() << "Failed to open input file:" << m_path;
-    emit errorOccurred(tr("无法打开文件: %1").arg(m_path));
+  if (MediaIO::openInput(&raw_fmt_ctx, path, &opts, &interrupt) < 0) {
+    qWarning() << "Failed to open input file:" << path;
+    if (isSource)
+      publish(m_state.setError(tr("无法打开文件: %1").arg(path)));
     av_dict_free(&opts);
     return false;
   }
   av_dict_free(&opts);
 
-  m_fmtCtx.reset(raw_fmt_ctx);
+  fmtCtx.reset(raw_fmt_ctx);
+  set_probe_limits(fmtCtx.get());
 
-  if (avformat_find_stream_info(m_fmtCtx.get(), nullptr) < 0) {
+  if (useProbeCache && m_probeCache.apply(fmtCtx.get())) {
+    qCDebug(lcPlayer) << "Open: stream info from probe cache in"
+                      << timer.elapsed() << "ms";
+    return true;
+  }
+  int wanted = nth_stream(fmtCtx.get(), type, track);
+  if (!(fmtCtx->ctx_flags & AVFMTCTX_NOHEADER) &&
+      fmtCtx->duration != AV_NOPTS_VALUE &&
+      (wanted < 0 || has_stream_params(fmtCtx->streams[wanted]))) {
+    qCDebug(lcPlayer) << "Open: fast open" << fmtCtx->iformat->name << "stream"
+                      << wanted << "in" << timer.elapsed() << "ms";
+    return true;
+  }
+  if (avformat_find_stream_info(fmtCtx.get(), nullptr) < 0) {
     qWarning() << "Failed to get stream info";
-    emit errorOccurred(tr("无法获取媒体流信息"));
+    if (isSource)
+      publish(m_state.setError(tr("无法获取媒体流信息")));
     return false;
   }
+  qCDebug(lcPlayer) << "Open: probed stream info in" << timer.elapsed() << "ms";
+  if (useProbeCache)
+    m_probeCache.store(fmtCtx.get());
 
   return true;
 }
 
+void FFMpegDecoder::reportFirstFrame() {
+  if (m_firstFrameReported.exchange(true))
+    return;
+  qint64 ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::steady_clock::now() - m_openTime)
+                  .count();
+  qCDebug(lcPlayer) << "Open: first frame after" << ms << "ms,"
+                    << (m_probeCache.warm() ? "warm (probe cache hit)"
+                                            : "cold");
+}
+
+bool FFMpegDecoder::prefillWhilePaused(const PausePrefill &prefill) const {
+  // A-B 循环由区间缓存负责，跳转、拖动和文件末尾时没有可预取的内容
+  return m_pause && !m_scrubbing && !m_seeking && !m_loop.active() && !m_eof &&
+         !prefill.full();
+}
+
+void FFMpegDecoder::reportResumeFrame(bool prefilled) {
+  if (m_resumeReported.exchange(true))
+    return;
+  qint64 ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::steady_clock::now() - m_resumeTime)
+                  .count();
+  qCDebug(lcPlayer) << "Resume: first frame after" << ms << "ms,"
+                    << (prefilled ? "from pause prefill"
+                                  : "decoded after resume");
+}
+
 void FFMpegDecoder::scanAudioStreams(AVFormatContextPtr &m_fmtCtx) {
   std::lock_guard<std::mutex> lk(m_mutex);
   m_audioStreamIndices.clear();
-  m_audioStreamNames.clear();
+  QStringList names;
 
   for (unsigned i = 0; i < m_fmtCtx->nb_streams; i++) {
     if (m_fmtCtx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO) {
       m_audioStreamIndices.push_back(i);
-      QString name = QString("Track %1").arg(m_audioStreamIndices.size());
-      AVDictionaryEntry *lang =
-          av_dict_get(m_fmtCtx->streams[i]->metadata, "language", nullptr, 0);
-      if (lang && lang->value)
-        name += QString(" [%1]").arg(lang->value);
-      m_audioStreamNames.push_back(name);
+      names.append(trackName(m_fmtCtx->streams[i],
+                             int(m_audioStreamIndices.size()), true));
     }
   }
+  publish(m_state.setAudioTracks(names));
 
   if (m_audioTrackIndex >= static_cast<int>(m_audioStreamIndices.size())) {
     m_audioTrackIndex = m_audioStreamIndices.empty() ? -1 : 0;
@@ -594,29 +1313,69 @@ bool FFMpegDecoder::initDecoder(int streamIndex, AVCodecContextPtr &actx,
   return resampler.init(actx.get());
 }
 
-bool FFMpegDecoder::handlePauseOrSeek() {
-  if (m_pause) {
-    std::unique_lock<std::mutex> lk(m_mutex);
-    m_cond.wait(lk, [&] { return m_stop || !m_pause || m_seeking; });
+bool FFMpegDecoder::seekByIndex(PacketBackBuffer &backBuffer, qint64 ms,
+                                qint64 &trimSample) {
+  // 往前多退两帧补足 MP3 位储备，解码后按采样裁掉目标之前的部分
+  qint64 offset = 0;
+  if (!m_seekIndex.ready() || !m_seekIndex.offsetFor(ms, 2, offset))
+    return false;
+  // 字节定位后解复用器给出的时间戳只是估算，回退缓冲区里的时间不可靠
+  backBuffer.clear();
+  if (av_seek_frame(m_fmtCtx.get(), -1, offset, AVSEEK_FLAG_BYTE) < 0)
+    return false;
+  trimSample = ms * m_seekIndex.sampleRate() / 1000;
+  qCDebug(lcPlayer) << "Seek index: audio seek to" << ms << "ms at byte"
+                    << offset;
+  return true;
+}
+
+bool FFMpegDecoder::handlePauseOrSeek(PacketBackBuffer &backBuffer,
+                                      AVCodecContext *actx,
+                                      qint64 &trimSample) {
+  // 先处理 seek：暂停或拖动期间发起的 seek 也要响应，否则会一直空转
+  if (m_seeking) {
+    if (m_audioSeekHandled) {
+      // 本线程已处理，等待视频线程完成同一次 seek
+      std::unique_lock<std::mutex> lk(m_mutex);
+      m_cond.wait(lk, [&] {
+        return m_stop || !m_seeking || !m_audioSeekHandled;
+      });
+      return true;
+    }
+    trimSample = -1;
+    m_audioPrefill.clear();
+    if (!seekByIndex(backBuffer, m_seekTarget, trimSample))
+      seekWithBackBuffer(m_fmtCtx.get(), backBuffer, m_seekTarget, "audio");
+    // 丢弃解码器内残留的旧位置数据
+    if (actx)
+      avcodec_flush_buffers(actx);
+    {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      m_audioSeekHandled = true;
+      if (m_videoSeekHandled)
+        m_seeking = false;
+    }
+    m_cond.notify_all();
     return true;
   }
 
-  if (m_seeking) {
-    int64_t ts = m_seekTarget * (AV_TIME_BASE / 1000);
-    av_seek_frame(m_fmtCtx.get(), -1, ts, AVSEEK_FLAG_BACKWARD);
-    m_audioSeekHandled = true;
-    if (m_videoSeekHandled)
-      m_seeking = false;
+  // 拖动预览期间音频保持静止；暂停后先继续解码到预取上限再睡眠
+  if (m_scrubbing || (m_pause && (m_audioTrackIndex == -1 ||
+                                  !prefillWhilePaused(m_audioPrefill)))) {
+    std::unique_lock<std::mutex> lk(m_mutex);
+    m_cond.wait(lk, [&] {
+      return m_stop || (!m_pause && !m_scrubbing) || m_seeking;
+    });
     return true;
   }
 
   return false;
 }
 
-void FFMpegDecoder::emitSilence() {
-  static QByteArray silence(2048, 0);
-  emit audioReady(silence);
-  std::this_thread::sleep_for(std::chrono::milliseconds(23));
+void FFMpegDecoder::waitForAudioTrack() {
+  // 静音时不输出数据，音频设备欠载后自行空闲；换音轨总会发起一次 seek
+  std::unique_lock<std::mutex> lk(m_mutex);
+  m_cond.wait(lk, [&] { return m_stop || (m_seeking && !m_audioSeekHandled); });
 }
 
 int FFMpegDecoder::getCurrentAudioStream() {
@@ -628,37 +1387,69 @@ int FFMpegDecoder::getCurrentAudioStream() {
 }
 
 void FFMpegDecoder::handleEOF() {
-  m_eof = true;
+  setEof(true);
   std::unique_lock<std::mutex> lk(m_mutex);
-  m_cond.wait_for(lk, std::chrono::milliseconds(50),
-                  [&] { return m_stop || m_seeking || m_eof == false; });
+  m_cond.wait(lk, [&] { return m_stop || m_seeking || m_eof == false; });
   if (m_seeking)
-    m_eof = false;
+    setEof(false);
 }
 
 // 音频解码循环：主循环
 void FFMpegDecoder::audioDecodeLoop() {
-  if (!openInputFile(m_fmtCtx))
+  if (!openInputFile(m_path, m_fmtCtx, AVMEDIA_TYPE_AUDIO, m_audioTrackIndex))
     return;
   scanAudioStreams(m_fmtCtx);
 
+  // MP3 / ADTS 裸流在后台建立精确跳转索引
+  if (m_localFile) {
+    m_seekIndex.start(m_path, m_fmtCtx->iformat->name, [this](qint64 ms) {
+      m_exactDurationMs = ms;
+      publish(m_state.setDuration(ms));
+    });
+  }
+
   AVCodecContextPtr actx = nullptr;
   AVPacketPtr pkt = make_avpacket();
   AVFramePtr frame = make_avframe();
   SwrBuffer resampler;
   AudioSynchronizer synchronizer;
+  PacketBackBuffer backBuffer(AUDIO_BACK_BUFFER_BYTES);
   int lastStream = -1;
   AVRational timeBase = {1, 1000};
+  int loopReplayIdx = 0;
+  qint64 trimSample = -1; // 索引跳转的目标采样，之前的采样需裁掉
 
   while (!m_stop) {
-    if (handlePauseOrSeek()) {
+    if (handlePauseOrSeek(backBuffer, actx.get(), trimSample)) {
       synchronizer.reset(m_playbackSpeed.load());
       continue;
     }
 
+    bool prefilling = m_pause && !m_scrubbing;
     int streamId = getCurrentAudioStream();
     if (streamId < 0) {
-      emitSilence();
+      waitForAudioTrack();
+      continue;
+    }
+
+    // A-B 循环：直接重放缓存的 PCM，不读文件
+    if (m_loopReplay) {
+      LoopRegionCache::AudioChunk chunk;
+      if (!m_loop.audioChunk(loopReplayIdx, chunk)) {
+        if (loopReplayIdx == 0) {
+          m_loopReplay = false;
+          seekToLoopStart();
+        }
+        loopReplayIdx = 0; // 回到 A 点
+        synchronizer.reset(m_playbackSpeed.load());
+        continue;
+      }
+      ++loopReplayIdx;
+      advanceAudioClock(chunk.ms);
+      m_loopReplayPos = chunk.ms;
+      synchronizer.sync(chunk.ms, m_playbackSpeed.load());
+      emit audioReady(chunk.pcm);
+      publish(m_state.setPosition(chunk.ms));
       continue;
     }
 
@@ -666,40 +1457,86 @@ void FFMpegDecoder::audioDecodeLoop() {
       if (!initDecoder(streamId, actx, resampler, timeBase))
         break;
       lastStream = streamId;
+      select_stream(m_fmtCtx.get(), streamId);
       synchronizer.reset(m_playbackSpeed.load());
+      backBuffer.reset(timeBase);
+      m_audioPrefill.clear();
     }
 
-    if (av_read_frame(m_fmtCtx.get(), pkt.get()) < 0) {
-      handleEOF();
-      continue;
-    }
+    // 有暂停预取的帧时先输出它们，不读包
+    bool fromPrefill = !prefilling && !m_audioPrefill.empty();
+    qint64 frameSample = -1;
+    if (!fromPrefill) {
+      bool replayed = backBuffer.next(pkt.get());
+      if (!replayed && av_read_frame(m_fmtCtx.get(), pkt.get()) < 0) {
+        if (m_loop.active()) {
+          onAudioLoopEnd(loopReplayIdx);
+          continue;
+        }
+        handleEOF();
+        continue;
+      }
 
-    if (pkt->stream_index != streamId) {
-      av_packet_unref(pkt.get());
-      continue;
-    }
+      if (pkt->stream_index != streamId) {
+        av_packet_unref(pkt.get());
+        continue;
+      }
+      if (!replayed && !m_seekIndex.ready())
+        backBuffer.push(pkt.get());
 
-    if (avcodec_send_packet(actx.get(), pkt.get()) < 0) {
+      // 有跳转索引时按包在文件中的位置得到精确的起始采样
+      frameSample = m_seekIndex.ready() && pkt->pos >= 0
+                        ? m_seekIndex.sampleAt(pkt->pos)
+                        : -1;
+
+      if (avcodec_send_packet(actx.get(), pkt.get()) < 0) {
+        av_packet_unref(pkt.get());
+        continue;
+      }
       av_packet_unref(pkt.get());
-      continue;
     }
-    av_packet_unref(pkt.get());
 
     while (!m_stop) {
-      // 解码音频帧
-      int ret = avcodec_receive_frame(actx.get(), frame.get());
+      // 解码音频帧；恢复播放后先取暂停期间预取的帧（连同其索引采样位置）
+      int64_t prefillSample = -1;
+      bool prefilled =
+          !prefilling && m_audioPrefill.pop(frame.get(), &prefillSample);
+      if (prefilled)
+        frameSample = prefillSample;
+      int ret = prefilled ? 0 : avcodec_receive_frame(actx.get(), frame.get());
       if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
         break;
       if (ret < 0 || frame->nb_samples == 0)
         break;
 
+      if (prefilling) {
+        // 暂停预取：存一份拷贝，恢复后按正常流程裁剪、重采样和输出
+        m_audioPrefill.push(frame.get(), frameSample);
+        if (frameSample >= 0)
+          frameSample += m_seekIndex.samplesPerFrame();
+        av_frame_unref(frame.get());
+        continue;
+      }
+
       int64_t pts = frame->pts != AV_NOPTS_VALUE ? frame->pts
                                                  : frame->best_effort_timestamp;
-      int64_t ms = av_rescale_q(pts, timeBase, {1, 1000});
-      m_audioClockMs.store(ms);
-
-      // 音频同步
-      synchronizer.sync(ms, m_playbackSpeed.load());
+      qint64 ms = av_rescale_q(pts, timeBase, {1, 1000});
+      qint64 skipSamples = 0; // 按索引跳转后需丢弃的采样（索引采样率）
+      if (frameSample >= 0) {
+        const int indexRate = m_seekIndex.sampleRate();
+        if (trimSample >= 0) {
+          // 预滚帧只用于补足位储备，整帧丢弃
+          if (frameSample + m_seekIndex.samplesPerFrame() <= trimSample) {
+            frameSample += m_seekIndex.samplesPerFrame();
+            av_frame_unref(frame.get());
+            continue;
+          }
+          skipSamples = std::max<qint64>(0, trimSample - frameSample);
+          trimSample = -1;
+        }
+        ms = (frameSample + skipSamples) * 1000 / indexRate;
+        frameSample += m_seekIndex.samplesPerFrame();
+      }
 
       // 重采样音频
       int outSamples = av_rescale_rnd(
@@ -714,10 +1551,43 @@ void FFMpegDecoder::audioDecodeLoop() {
       int dataSize = av_samples_get_buffer_size(nullptr, OUT_CHANNELS,
                                                 converted, OUT_SAMPLE_FMT, 1);
       QByteArray pcm = QByteArray::fromRawData((const char *)out[0], dataSize);
+      if (skipSamples > 0) {
+        int skipBytes =
+            int(av_rescale(skipSamples, OUT_SAMPLE_RATE, m_seekIndex.sampleRate())) *
+            OUT_CHANNELS * av_get_bytes_per_sample(OUT_SAMPLE_FMT);
+        skipBytes = std::min(skipBytes, dataSize);
+        pcm = QByteArray::fromRawData((const char *)out[0] + skipBytes,
+                                      dataSize - skipBytes);
+      }
+
+      // A-B 循环：裁掉区间外的采样，首轮记录到缓存
+      bool loopEnded = false;
+      if (m_loop.active() && !clipToLoopRegion(ms, pcm, loopEnded)) {
+        av_frame_unref(frame.get());
+        continue;
+      }
 
-      emit audioReady(pcm);
-      emit positionChanged(ms);
+      advanceAudioClock(ms);
+
+      // 音频同步
+      synchronizer.sync(ms, m_playbackSpeed.load());
+
+      if (!pcm.isEmpty()) {
+        if (m_loop.active())
+          m_loop.addAudio(ms, pcm);
+        emit audioReady(pcm);
+        if (!hasVideoTrack()) {
+          reportFirstFrame();
+          reportResumeFrame(prefilled);
+        }
+      }
+      publish(m_state.setPosition(ms));
       av_frame_unref(frame.get());
+
+      if (loopEnded) {
+        onAudioLoopEnd(loopReplayIdx);
+        break;
+      }
     }
   }
 }
@@ -7,43 +7,52 @@
 #include <QtDebug>
 #include <atomic>
 #include <condition_variable>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <thread>
 
-extern "C" {
-#include <libavcodec/avcodec.h>
-#include <libavformat/avformat.h>
-#include <libavutil/imgutils.h>
-#include <libavutil/opt.h>
-#include <libswresample/swresample.h>
-#include <libswscale/swscale.h>
-}
-
-// 智能指针管理 AVFrame
-template <typename T, void (*FreeFunc)(T **)> struct FFmpegDeleter {
-  void operator()(T *ptr) const {
-    if (ptr) {
-      FreeFunc(&ptr);
-    }
-  }
-};
-
-using AVFramePtr =
-    std::unique_ptr<AVFrame, FFmpegDeleter<AVFrame, av_frame_free>>;
-using AVPacketPtr =
-    std::unique_ptr<AVPacket, FFmpegDeleter<AVPacket, av_packet_free>>;
-using AVCodecContextPtr =
-    std::unique_ptr<AVCodecContext,
-                    FFmpegDeleter<AVCodecContext, avcodec_free_context>>;
-using AVFormatContextPtr =
-    std::unique_ptr<AVFormatContext,
-                    FFmpegDeleter<AVFormatContext, avformat_close_input>>;
+#include "AudioSeekIndex.h"
+#include "DecodeQualityController.h"
+#include "DecoderState.h"
+#include "FFmpegUtils.h"
+#include "FrameDecimator.h"
+#include "FrameMailbox.h"
+#include "GopCache.h"
+#include "LoopRegionCache.h"
+#include "PacketBackBuffer.h"
+#include "PausePrefill.h"
+#include "ProbeCache.h"
+#include "ProxyTranscoder.h"
+#include "VariantSelector.h"
 
 static const int OUT_SAMPLE_RATE = 44100;
 static const int OUT_CHANNELS = 2;
 static const AVSampleFormat OUT_SAMPLE_FMT = AV_SAMPLE_FMT_S16;
 
+// 回退缓冲区内存上限（字节）
+static const size_t VIDEO_BACK_BUFFER_BYTES = 8 * 1024 * 1024;
+static const size_t AUDIO_BACK_BUFFER_BYTES = 1024 * 1024;
+
+// A-B 循环区间缓存上限（字节），超出则回落为到达 B 点时回跳
+static const size_t LOOP_CACHE_BYTES = 64 * 1024 * 1024;
+
+// 逐帧步进/倒放 GOP 缓存上限（字节）
+static const size_t GOP_CACHE_BYTES = 96 * 1024 * 1024;
+
+// 不短于该时长的视频才考虑转码代理文件
+static const qint64 PROXY_MIN_DURATION_MS = 60 * 1000;
+
+// 暂停期间预先解码的帧的内存上限（字节）
+static const size_t VIDEO_PREFILL_BYTES = 24 * 1024 * 1024;
+static const size_t AUDIO_PREFILL_BYTES = 512 * 1024;
+
+// HLS 变体切换等待新变体关键帧的最长时间，超时放弃本次切换
+static const int VARIANT_SWITCH_TIMEOUT_MS = 15000;
+
+// 达到该倍速时自动切换为仅解码关键帧
+static const float KEYFRAME_ONLY_SPEED = 4.0f;
+
 // ===== 音频解码循环相关类 =====
 class AudioSynchronizer {
 public:
@@ -144,25 +153,63 @@ public:
 
   // 音轨切换
   void setAudioTrack(int index); // index=-1 为静音
-  int audioTrackCount() const;
   int currentAudioTrack() const;
-  QString audioTrackName(int idx) const;
 
   // 视频轨道切换
   void setVideoTrack(int index); // index=-1 为无视频
-  int videoTrackCount() const;
   int currentVideoTrack() const;
-  QString videoTrackName(int idx) const;
+
+  // HLS 多码率：自动按解码余量选择变体，手动选择视频轨道后关闭
+  bool hasVariants() const;
+  bool variantAuto() const;
+  void setVariantAuto(bool enable);
+
+  // 打开轨道菜单时调用：首次打开只探测了要播放的流，在后台补全其余流并写入
+  // 探测缓存，完成后按补全的编码参数更新轨道名
+  void probeAllStreams();
 
   // 倍速支持
   void setPlaybackSpeed(float speed);
 
+  // 仅关键帧解码（快进/拖动预览）
+  void setKeyframeOnly(bool enable);
+  bool isKeyframeOnly() const;
+  void beginScrub(); // 开始拖动：音频暂停，视频只显示目标附近的关键帧
+  void endScrub();   // 结束拖动：恢复完整解码
+
+  // A-B 循环
+  void setLoopRegion(qint64 startMs, qint64 endMs);
+  void clearLoopRegion();
+  bool hasLoopRegion() const;
+
+  // 逐帧步进与倒放（均会进入暂停，恢复播放时从当前画面位置继续）
+  void stepFrame(int direction); // 1 为下一帧，-1 为上一帧
+  void setReversePlayback(bool enable);
+  bool isReversePlayback() const;
+
+  // 屏幕刷新率，用于计算倍速播放时的可显示帧率
+  void setDisplayRefreshRate(double hz);
+
+  // 当前自适应解码质量等级（CPU 跟不上时自动降级）
+  DecodeQualityController::Level decodeQuality() const;
+
+  // 显示区域尺寸，用于选择 lowres 解码等级并限制输出和缓存帧的分辨率
+  void setDisplaySize(int width, int height);
+
+  // 取走信箱中最新的解码帧（收到 frameAvailable 后在绘制时调用），由界面转换
+  std::unique_ptr<FrameMailbox::Frame> takeFrame();
+
+  // 读取位置、时长、EOF、轨道列表和错误的快照（收到 stateChanged 后在绘制时调用）
+  void readState(DecoderState::Snapshot &snap);
+
 signals:
+  // 已转换好的画面（A-B 循环、逐帧步进等），空指针表示清空画面
   void frameReady(const QSharedPointer<QImage> &img);
+  // 信箱由空变为有帧
+  void frameAvailable();
   void audioReady(const QByteArray &pcm);
-  void durationChanged(qint64 ms);
-  void positionChanged(qint64 ms);
-  void errorOccurred(const QString &message); // 新增：错误信号
+  // 状态快照有变化，且上一次变化已被读取
+  void stateChanged();
 
 private:
   // 线程与同步
@@ -176,17 +223,21 @@ private:
   std::condition_variable m_cond;
 
   // seek 同步标志
-  bool m_videoSeekHandled = false;
-  bool m_audioSeekHandled = false;
+  std::atomic<bool> m_videoSeekHandled{false};
+  std::atomic<bool> m_audioSeekHandled{false};
 
   // 播放结束标志
   std::atomic<bool> m_eof{false}; // 新增
 
-  // 音频时钟（ms）
+  // 音频时钟（ms）；视频线程跟随时钟等待时登记，音频线程推进时钟后唤醒它
   std::atomic<qint64> m_audioClockMs{0};
+  std::atomic<int> m_clockWaiters{0};
+  void advanceAudioClock(qint64 ms);
+  void waitAudioClock(const std::function<bool()> &ready);
 
   // 播放参数
   QString m_path;
+  bool m_localFile = false; // 网络输入不做依赖本地文件的缓存（探测、跳转索引、代理）
 
   // 解码主循环
   void videoDecodeLoop();
@@ -194,23 +245,104 @@ private:
 
   // 音频解码循环相关
   AVFormatContextPtr m_fmtCtx;
-  bool openInputFile(AVFormatContextPtr &m_fmtCtx);
+  static int stopRequested(void *opaque); // 中断回调：停止时中断阻塞的读取
+  // 轨道名：序号、语言，withParams 时附上编码器和声道数 / 分辨率
+  static QString trackName(const AVStream *stream, int number, bool withParams);
+  void publishProbedTracks(const AVFormatContext *fmtCtx);
+  bool openInputFile(const QString &path, AVFormatContextPtr &fmtCtx,
+                     AVMediaType type, int track);
   void scanAudioStreams(AVFormatContextPtr &m_fmtCtx);
   bool initDecoder(int streamIndex, AVCodecContextPtr &actx,
                    SwrBuffer &resampler, AVRational &timeBase);
-  bool handlePauseOrSeek();
-  void emitSilence();
+  bool handlePauseOrSeek(PacketBackBuffer &backBuffer, AVCodecContext *actx,
+                         qint64 &trimSample);
+  void waitForAudioTrack(); // 静音或无音频流时睡眠到换轨、跳转或停止
   void handleEOF();
   int getCurrentAudioStream();
 
   int m_audioTrackIndex = 0;                       // -1为静音
   mutable std::vector<int> m_audioStreamIndices;   // 存储所有音频流索引
-  mutable std::vector<QString> m_audioStreamNames; // 存储音轨描述
 
   int m_videoTrackIndex = 0; // -1为无视频
   mutable std::vector<int> m_videoStreamIndices;
-  mutable std::vector<QString> m_videoStreamNames;
 
   // 倍速支持
   std::atomic<float> m_playbackSpeed{1.0f};
+
+  // 仅关键帧解码
+  std::atomic<bool> m_keyframeOnly{false};
+  std::atomic<bool> m_scrubbing{false};
+  bool useKeyframeOnly() const;
+
+  // 发布给界面的状态；publish 在快照由已读变为有变化时通知界面
+  DecoderState m_state;
+  void publish(bool changed);
+  void setEof(bool eof);
+
+  // 正常播放的帧经信箱交给界面；直接给出 QImage 时先清空信箱，避免旧帧覆盖
+  FrameMailbox m_mailbox;
+  void presentImage(const QSharedPointer<QImage> &img);
+
+  // 自适应解码质量，仅由视频线程调整
+  DecodeQualityController m_quality;
+  FrameDecimator m_decimator;
+
+  // 回退缓冲区：命中时从内存重放，未命中时清空并回落到 av_seek_frame
+  void seekWithBackBuffer(AVFormatContext *fmtCtx, PacketBackBuffer &backBuffer,
+                          qint64 ms, const char *tag);
+  std::atomic<qint64> m_backBufferLookups{0};
+  std::atomic<qint64> m_backBufferHits{0};
+
+  // A-B 循环
+  LoopRegionCache m_loop{LOOP_CACHE_BYTES};
+  std::atomic<bool> m_loopReplay{false}; // 正在从缓存重放循环区间
+  std::atomic<qint64> m_loopReplayPos{0};
+  void requestSeek(qint64 ms);
+  void seekToLoopStart();
+  bool clipToLoopRegion(qint64 &ms, QByteArray &pcm, bool &reachedEnd);
+  void onAudioLoopEnd(int &replayIdx);
+  void onVideoLoopEnd(int &replayIdx);
+  void replayLoopVideo(int &idx, bool followAudio);
+  bool hasVideoTrack() const;
+
+  // MP3 / ADTS 精确跳转索引与由其得到的精确时长（0 表示未知）
+  AudioSeekIndex m_seekIndex;
+  std::atomic<qint64> m_exactDurationMs{0};
+  bool seekByIndex(PacketBackBuffer &backBuffer, qint64 ms, qint64 &trimSample);
+
+  // 逐帧步进与倒放
+  GopCache m_gop{GOP_CACHE_BYTES};
+  std::atomic<int> m_stepRequest{0};
+  std::atomic<bool> m_reverse{false};
+  std::atomic<bool> m_gopDirty{false}; // 画面已离开主解码位置，恢复播放前需重新定位
+  std::atomic<qint64> m_videoClockMs{0}; // 最近一次显示的视频帧时间
+  void serveFromGopCache(int streamIndex);
+  void resumeFromGopCache();
+
+  // 显示区域尺寸（0 表示未知），决定 lowres 等级和转换输出尺寸
+  std::atomic<int> m_displayWidth{0};
+  std::atomic<int> m_displayHeight{0};
+  std::atomic<bool> m_displaySizeChanged{false};
+
+  // 解码跟不上实时的文件在后台转码的代理
+  ProxyTranscoder m_proxy;
+
+  // HLS 变体选择，仅由视频线程调整
+  VariantSelector m_variants;
+  std::atomic<bool> m_variantAuto{true};
+
+  // 探测结果缓存；两个线程的打开串行化，后打开的直接用先打开者的探测结果
+  ProbeCache m_probeCache;
+  std::mutex m_openMutex;
+  std::chrono::steady_clock::time_point m_openTime;
+  std::atomic<bool> m_firstFrameReported{false};
+  void reportFirstFrame();
+
+  // 暂停期间的预取，各由所属的解码线程访问；恢复播放时统计到第一帧的耗时
+  PausePrefill m_videoPrefill{VIDEO_PREFILL_BYTES};
+  PausePrefill m_audioPrefill{AUDIO_PREFILL_BYTES};
+  bool prefillWhilePaused(const PausePrefill &prefill) const;
+  std::chrono::steady_clock::time_point m_resumeTime;
+  std::atomic<bool> m_resumeReported{true};
+  void reportResumeFrame(bool prefilled);
 };
\ No newline at end of file
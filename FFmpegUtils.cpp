@@ -0,0 +1,118 @@
+#include "FFmpegUtils.h"
+#include "MediaIO.h"
+#include <QString>
+#include <algorithm>
+#include <cstring>
+
+void close_input(AVFormatContext **ctx) {
+  AVIOContext *pb =
+      *ctx && ((*ctx)->flags & AVFMT_FLAG_CUSTOM_IO) ? (*ctx)->pb : nullptr;
+  avformat_close_input(ctx);
+  MediaIO::destroy(pb);
+}
+
+AVFramePtr make_avframe() { return AVFramePtr(av_frame_alloc()); }
+AVPacketPtr make_avpacket() { return AVPacketPtr(av_packet_alloc()); }
+AVCodecContextPtr make_avcodec_ctx(AVCodec *codec) {
+  return AVCodecContextPtr(avcodec_alloc_context3(codec));
+}
+
+AVCodec *find_decoder(AVCodecID id, AVMediaType type) {
+  AVCodec *iter = av_codec_next(nullptr);
+  while (iter) {
+    if (iter->id == id && iter->decode != nullptr && iter->type == type) {
+      if (QString(iter->name).contains("rk", Qt::CaseInsensitive)) {
+        iter = av_codec_next(iter);
+        continue;
+      }
+      return iter;
+    }
+    iter = av_codec_next(iter);
+  }
+  return nullptr;
+}
+
+void fit_within(int width, int height, int maxWidth, int maxHeight,
+                int &outWidth, int &outHeight) {
+  outWidth = width;
+  outHeight = height;
+  if (maxWidth <= 0 || maxHeight <= 0 || width <= 0 || height <= 0 ||
+      (width <= maxWidth && height <= maxHeight))
+    return;
+  double scale = std::min(double(maxWidth) / width, double(maxHeight) / height);
+  outWidth = std::max(2, int(width * scale) & ~1);
+  outHeight = std::max(2, int(height * scale) & ~1);
+}
+
+int choose_lowres(const AVCodec *codec, int width, int height, int maxWidth,
+                  int maxHeight) {
+  if (!codec || width <= 0 || height <= 0)
+    return 0;
+  int fitWidth = 0, fitHeight = 0;
+  fit_within(width, height, maxWidth, maxHeight, fitWidth, fitHeight);
+  int maxLowres = std::min(av_codec_get_max_lowres(codec), 3);
+  int lowres = 0;
+  while (lowres < maxLowres && (width >> (lowres + 1)) >= fitWidth &&
+         (height >> (lowres + 1)) >= fitHeight)
+    ++lowres;
+  return lowres;
+}
+
+void set_probe_limits(AVFormatContext *fmtCtx) {
+  struct Limits {
+    const char *format;
+    int64_t probeBytes;
+    int64_t analyzeUs;
+  };
+  // 按 AVInputFormat::name 的第一个名字匹配
+  static const Limits table[] = {
+      {"matroska", 256 * 1024, 500000}, {"mov", 256 * 1024, 500000},
+      {"mp3", 64 * 1024, 100000},       {"aac", 64 * 1024, 100000},
+      {"flac", 64 * 1024, 100000},      {"wav", 64 * 1024, 100000},
+      {"ogg", 128 * 1024, 500000},      {"flv", 512 * 1024, 1000000},
+      {"avi", 512 * 1024, 1000000},     {"mpegts", 2 * 1024 * 1024, 1500000},
+      {"mpeg", 2 * 1024 * 1024, 1500000},
+  };
+  int64_t probeBytes = 1024 * 1024, analyzeUs = 1000000;
+  const char *name = fmtCtx->iformat ? fmtCtx->iformat->name : "";
+  size_t len = strcspn(name, ",");
+  for (const Limits &l : table) {
+    if (strlen(l.format) == len && strncmp(name, l.format, len) == 0) {
+      probeBytes = l.probeBytes;
+      analyzeUs = l.analyzeUs;
+      break;
+    }
+  }
+  fmtCtx->probesize = probeBytes;
+  fmtCtx->max_analyze_duration = analyzeUs;
+}
+
+bool has_stream_params(const AVStream *stream) {
+  const AVCodecParameters *par = stream->codecpar;
+  if (par->codec_id == AV_CODEC_ID_NONE)
+    return false;
+  switch (par->codec_type) {
+  case AVMEDIA_TYPE_VIDEO:
+    return par->width > 0 && par->height > 0;
+  case AVMEDIA_TYPE_AUDIO:
+    return par->sample_rate > 0 && par->channels > 0;
+  default:
+    return true;
+  }
+}
+
+int nth_stream(const AVFormatContext *fmtCtx, AVMediaType type, int n) {
+  if (n < 0)
+    return -1;
+  for (unsigned i = 0; i < fmtCtx->nb_streams; i++) {
+    if (fmtCtx->streams[i]->codecpar->codec_type == type && n-- == 0)
+      return int(i);
+  }
+  return -1;
+}
+
+void select_stream(AVFormatContext *fmtCtx, int index) {
+  for (unsigned i = 0; i < fmtCtx->nb_streams; i++)
+    fmtCtx->streams[i]->discard =
+        int(i) == index ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <memory>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/opt.h>
+#include <libswresample/swresample.h>
+#include <libswscale/swscale.h>
+}
+
+// 智能指针管理 AVFrame
+template <typename T, void (*FreeFunc)(T **)> struct FFmpegDeleter {
+  void operator()(T *ptr) const {
+    if (ptr) {
+      FreeFunc(&ptr);
+    }
+  }
+};
+
+using AVFramePtr =
+    std::unique_ptr<AVFrame, FFmpegDeleter<AVFrame, av_frame_free>>;
+using AVPacketPtr =
+    std::unique_ptr<AVPacket, FFmpegDeleter<AVPacket, av_packet_free>>;
+using AVCodecContextPtr =
+    std::unique_ptr<AVCodecContext,
+                    FFmpegDeleter<AVCodecContext, avcodec_free_context>>;
+// 关闭输入，同时释放 MediaIO 提供的自定义 I/O
+void close_input(AVFormatContext **ctx);
+using AVFormatContextPtr =
+    std::unique_ptr<AVFormatContext, FFmpegDeleter<AVFormatContext, close_input>>;
+
+AVFramePtr make_avframe();
+AVPacketPtr make_avpacket();
+AVCodecContextPtr make_avcodec_ctx(AVCodec *codec);
+
+// 查找解码器（跳过 rk 硬件解码器）
+AVCodec *find_decoder(AVCodecID id, AVMediaType type);
+
+// 按比例缩小到不超过 maxWidth × maxHeight（只缩小不放大，尺寸取偶数），
+// maxWidth / maxHeight 为 0 时保持原尺寸
+void fit_within(int width, int height, int maxWidth, int maxHeight,
+                int &outWidth, int &outHeight);
+
+// 选择解码器 lowres 等级（0~3，即 1、1/2、1/4、1/8 分辨率）：
+// 在不小于显示尺寸的前提下尽量降低，解码器不支持 lowres 时为 0
+int choose_lowres(const AVCodec *codec, int width, int height, int maxWidth,
+                  int maxHeight);
+
+// 按容器设置探测数据量和分析时长：文件头完整的容器只需很少数据，
+// 没有文件头的流式容器要多读一些才能发现全部流
+void set_probe_limits(AVFormatContext *fmtCtx);
+
+// 文件头是否已给出解码所需的编码参数，可以不经 avformat_find_stream_info 直接使用
+bool has_stream_params(const AVStream *stream);
+
+// 第 n 路 type 类型流的索引，不存在时返回 -1
+int nth_stream(const AVFormatContext *fmtCtx, AVMediaType type, int n);
+
+// 解复用时只保留 index 一路流，其余流的包直接丢弃
+void select_stream(AVFormatContext *fmtCtx, int index);
@@ -0,0 +1,39 @@
+#include "FrameDecimator.h"
+#include "PlayerLog.h"
+#include <algorithm>
+
+constexpr double FrameDecimator::UI_MAX_FPS;
+
+void FrameDecimator::setDisplayRate(double hz) {
+  if (hz > 1.0)
+    m_displayRate = hz;
+}
+
+void FrameDecimator::reset() { m_nextMs = -1; }
+
+AVDiscard FrameDecimator::update(double contentFps, double speed) {
+  double presentFps = std::min(m_displayRate.load(), UI_MAX_FPS);
+  // 略微放宽，避免 30 fps × 2 倍速这类恰好相等的情况因误差被判为超出
+  bool active = contentFps > 0 && contentFps * speed > presentFps * 1.05;
+  if (active != m_active) {
+    qCDebug(lcPlayer) << "Frame decimation" << (active ? "on" : "off") << "at"
+                      << speed << "x," << contentFps << "fps content,"
+                      << presentFps << "fps display";
+    m_active = active;
+    m_nextMs = -1;
+  }
+  m_intervalMs = 1000.0 * speed / presentFps;
+  return m_active ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
+}
+
+bool FrameDecimator::shouldPresent(qint64 ms) {
+  if (!m_active)
+    return true;
+  // 容许四分之一节拍的抖动；首帧、时间回退（跳转、循环）或落后太多时重新对齐
+  bool realign = m_nextMs < 0 || ms < m_nextMs - 2 * m_intervalMs ||
+                 ms >= m_nextMs + m_intervalMs;
+  if (!realign && ms + m_intervalMs / 4 < m_nextMs)
+    return false;
+  m_nextMs = qint64((realign ? ms : m_nextMs) + m_intervalMs);
+  return true;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "FFmpegUtils.h"
+#include <QtGlobal>
+#include <atomic>
+
+// 倍速播放时的抽帧策略
+// 可显示帧率取屏幕刷新率与界面刷新上限中的较小者。内容帧率 × 倍速超过它时，
+// 解码前丢弃非参考帧，并且只转换、显示落在显示节拍上的帧，
+// 使解码和转换的开销基本不随倍速增长。4 倍速及以上由关键帧模式接管。
+class FrameDecimator {
+public:
+  void setDisplayRate(double hz);
+  void reset(); // 跳转后重新对齐显示节拍
+
+  // 根据内容帧率和倍速更新策略，返回解码前应使用的 skip_frame 下限
+  AVDiscard update(double contentFps, double speed);
+
+  // 该帧是否落在显示节拍上，不在节拍上的帧直接跳过
+  bool shouldPresent(qint64 ms);
+
+  bool active() const { return m_active; }
+
+private:
+  static constexpr double UI_MAX_FPS = 60.0; // 界面 16 ms 刷新一次
+
+  std::atomic<double> m_displayRate{UI_MAX_FPS};
+  bool m_active = false;
+  double m_intervalMs = 0; // 相邻两次显示之间的媒体时间
+  qint64 m_nextMs = -1;
+};
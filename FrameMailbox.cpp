@@ -0,0 +1,54 @@
+#include "FrameMailbox.h"
+
+FrameMailbox::~FrameMailbox() { clear(); }
+
+bool FrameMailbox::post(const AVFrame *frame, qint64 ms, int width, int height,
+                        int swsFlags) {
+  std::unique_ptr<Frame> item(new Frame);
+  item->frame = make_avframe();
+  if (!item->frame || av_frame_ref(item->frame.get(), frame) < 0)
+    return false;
+  item->ms = ms;
+  item->width = width;
+  item->height = height;
+  item->swsFlags = swsFlags;
+  ++m_posted;
+  Frame *old = m_slot.exchange(item.release());
+  if (!old)
+    return true;
+  ++m_dropped;
+  delete old;
+  return false;
+}
+
+std::unique_ptr<FrameMailbox::Frame> FrameMailbox::take() {
+  return std::unique_ptr<Frame>(m_slot.exchange(nullptr));
+}
+
+void FrameMailbox::clear() { delete m_slot.exchange(nullptr); }
+
+FrameConverter::~FrameConverter() {
+  if (m_sws)
+    sws_freeContext(m_sws);
+}
+
+QSharedPointer<QImage> FrameConverter::convert(const AVFrame *frame, int width,
+                                               int height, int swsFlags) {
+  if (width <= 0 || height <= 0)
+    return QSharedPointer<QImage>();
+  m_sws = sws_getCachedContext(m_sws, frame->width, frame->height,
+                               (AVPixelFormat)frame->format, width, height,
+                               AV_PIX_FMT_RGB24, swsFlags, nullptr, nullptr,
+                               nullptr);
+  if (!m_sws)
+    return QSharedPointer<QImage>();
+
+  QSharedPointer<QImage> img(new QImage(width, height, QImage::Format_RGB888));
+  if (img->isNull())
+    return QSharedPointer<QImage>();
+  uint8_t *dst[1] = {img->bits()};
+  int dst_linesize[1] = {img->bytesPerLine()};
+  sws_scale(m_sws, frame->data, frame->linesize, 0, frame->height, dst,
+            dst_linesize);
+  return img;
+}
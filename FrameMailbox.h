@@ -0,0 +1,51 @@
+#pragma once
+#include "FFmpegUtils.h"
+#include <QImage>
+#include <QSharedPointer>
+#include <atomic>
+#include <memory>
+
+// 视频线程到界面线程的最新帧信箱
+// 单槽、无锁：视频线程投递解码帧的引用（连同转换参数），替换掉槽中还没被取走的
+// 旧帧；界面每次绘制取一次，只转换真正要显示的那一帧。界面跟不上解码时，被替换
+// 的帧从未做过 sws_scale。只有槽由空变为非空时才需要通知界面，排队的通知最多一个。
+class FrameMailbox {
+public:
+  struct Frame {
+    AVFramePtr frame;
+    qint64 ms = 0;
+    int width = 0; // 转换输出尺寸
+    int height = 0;
+    int swsFlags = 0;
+  };
+
+  ~FrameMailbox();
+
+  // 投递一帧（引用计数，不拷贝数据）；返回 true 表示槽原本为空，需要通知界面
+  bool post(const AVFrame *frame, qint64 ms, int width, int height,
+            int swsFlags);
+
+  // 取走最新的一帧，槽为空时返回空指针
+  std::unique_ptr<Frame> take();
+
+  void clear(); // 丢弃未取走的帧
+
+  qint64 posted() const { return m_posted; }
+  qint64 dropped() const { return m_dropped; } // 未经转换即被替换的帧数
+
+private:
+  std::atomic<Frame *> m_slot{nullptr};
+  std::atomic<qint64> m_posted{0};
+  std::atomic<qint64> m_dropped{0};
+};
+
+// AVFrame 到 RGB888 QImage 的转换，缓存 SwsContext
+class FrameConverter {
+public:
+  ~FrameConverter();
+  QSharedPointer<QImage> convert(const AVFrame *frame, int width, int height,
+                                 int swsFlags);
+
+private:
+  SwsContext *m_sws = nullptr;
+};
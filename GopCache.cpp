@@ -0,0 +1,374 @@
+#include "GopCache.h"
+#include "MediaIO.h"
+#include "PlayerLog.h"
+#include <QtDebug>
+#include <algorithm>
+#include <cstdlib>
+
+GopCache::GopCache(size_t maxBytes) : m_segmentBytes(maxBytes / MAX_SEGMENTS) {}
+
+GopCache::~GopCache() { close(); }
+
+bool GopCache::open(const QString &path, int streamIndex,
+                    const AVIOInterruptCB *interrupt) {
+  close();
+  m_stop = false;
+  m_interrupt = interrupt ? *interrupt : AVIOInterruptCB{nullptr, nullptr};
+
+  // 网络输入经磁盘缓存读取，已下载的部分不再联网
+  AVIOInterruptCB cb = {&GopCache::interrupted, this};
+  AVFormatContext *raw_fmt_ctx = nullptr;
+  if (MediaIO::openInput(&raw_fmt_ctx, path, nullptr, &cb) < 0) {
+    qWarning() << "GOP cache: failed to open input file:" << path;
+    return false;
+  }
+  m_fmtCtx.reset(raw_fmt_ctx);
+  set_probe_limits(m_fmtCtx.get());
+  // 只用一路视频，文件头已给出其参数时不必探测
+  bool known = !(m_fmtCtx->ctx_flags & AVFMTCTX_NOHEADER) && streamIndex >= 0 &&
+               streamIndex < int(m_fmtCtx->nb_streams) &&
+               has_stream_params(m_fmtCtx->streams[streamIndex]);
+  if ((!known && avformat_find_stream_info(m_fmtCtx.get(), nullptr) < 0) ||
+      streamIndex < 0 || streamIndex >= int(m_fmtCtx->nb_streams)) {
+    qWarning() << "GOP cache: invalid video stream" << streamIndex;
+    m_fmtCtx.reset();
+    return false;
+  }
+  select_stream(m_fmtCtx.get(), streamIndex);
+
+  AVStream *stream = m_fmtCtx->streams[streamIndex];
+  AVCodec *codec =
+      find_decoder(stream->codecpar->codec_id, AVMEDIA_TYPE_VIDEO);
+  if (codec)
+    m_codecCtx = make_avcodec_ctx(codec);
+  bool ok = codec && m_codecCtx &&
+            avcodec_parameters_to_context(m_codecCtx.get(), stream->codecpar) >= 0;
+  if (ok) {
+    // 缓存帧只需显示尺寸，支持 lowres 的解码器直接按缩小的分辨率解码
+    m_codecCtx->lowres =
+        choose_lowres(codec, stream->codecpar->width, stream->codecpar->height,
+                      m_targetWidth, m_targetHeight);
+    ok = avcodec_open2(m_codecCtx.get(), codec, nullptr) >= 0;
+  }
+  if (!ok) {
+    qWarning() << "GOP cache: failed to open video decoder";
+    m_codecCtx.reset();
+    m_fmtCtx.reset();
+    return false;
+  }
+
+  // 其他流一律不读，减少 av_read_frame 的开销
+  for (unsigned i = 0; i < m_fmtCtx->nb_streams; i++) {
+    if (int(i) != streamIndex)
+      m_fmtCtx->streams[i]->discard = AVDISCARD_ALL;
+  }
+
+  m_streamIndex = streamIndex;
+  m_timeBase = stream->time_base;
+  m_open = true;
+  m_worker = std::thread(&GopCache::workerLoop, this);
+  return true;
+}
+
+int GopCache::interrupted(void *opaque) {
+  GopCache *self = static_cast<GopCache *>(opaque);
+  const AVIOInterruptCB &cb = self->m_interrupt;
+  return self->m_stop || (cb.callback && cb.callback(cb.opaque)) ? 1 : 0;
+}
+
+void GopCache::close() {
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_stop = true;
+  }
+  m_cond.notify_all();
+  if (m_worker.joinable())
+    m_worker.join();
+
+  m_open = false;
+  m_streamIndex = -1;
+  m_codecCtx.reset();
+  m_fmtCtx.reset();
+  if (m_sws)
+    sws_freeContext(m_sws);
+  m_sws = nullptr;
+
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_requests.clear();
+  m_segments.clear();
+  m_nextId = 0;
+  m_doneId = 0;
+}
+
+void GopCache::setTargetSize(int width, int height) {
+  m_targetWidth = width;
+  m_targetHeight = height;
+}
+
+bool GopCache::frameBefore(qint64 ms, Frame &out, bool wait) {
+  bool found = false;
+  quint64 id = 0;
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    qint64 prefetch = -1;
+    found = findBefore(ms, out, prefetch);
+    // 命中时预取前一段供倒放继续使用，未命中则解码目标所在的一段
+    qint64 anchor = found ? prefetch : ms - 1;
+    if (anchor >= 0)
+      id = request(anchor);
+  }
+  if (id)
+    m_cond.notify_all();
+  if (found || !id || !wait)
+    return found;
+  waitFor(id);
+  return frameBefore(ms, out, false);
+}
+
+bool GopCache::frameAfter(qint64 ms, Frame &out, bool wait) {
+  quint64 id = 0;
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    qint64 next = ms + 1;
+    if (findAfter(ms, out, next))
+      return true;
+    if (next < 0) // 已到文件末尾
+      return false;
+    id = request(next);
+  }
+  if (!id)
+    return false;
+  m_cond.notify_all();
+  if (!wait)
+    return false;
+  waitFor(id);
+  return frameAfter(ms, out, false);
+}
+
+bool GopCache::findBefore(qint64 ms, Frame &out, qint64 &prefetch) const {
+  for (const Segment &seg : m_segments) {
+    if (seg.frames.empty() || seg.frames.front().ms >= ms || ms > seg.coverEnd)
+      continue;
+    auto it = std::lower_bound(
+        seg.frames.begin(), seg.frames.end(), ms,
+        [](const Frame &f, qint64 value) { return f.ms < value; });
+    out = *(it - 1);
+    prefetch = seg.frames.front().ms - 1;
+    return true;
+  }
+  return false;
+}
+
+bool GopCache::findAfter(qint64 ms, Frame &out, qint64 &next) const {
+  for (const Segment &seg : m_segments) {
+    if (seg.frames.empty() || ms < seg.frames.front().ms || ms >= seg.coverEnd)
+      continue;
+    auto it = std::upper_bound(
+        seg.frames.begin(), seg.frames.end(), ms,
+        [](qint64 value, const Frame &f) { return value < f.ms; });
+    if (it != seg.frames.end()) {
+      out = *it;
+      return true;
+    }
+    if (seg.eof) {
+      next = -1;
+      return false;
+    }
+    // 本段到下一个关键帧之间没有帧，答案是下一个 GOP 的首帧
+    next = seg.coverEnd;
+    for (const Segment &other : m_segments) {
+      if (!other.frames.empty() && other.frames.front().ms == seg.coverEnd) {
+        out = other.frames.front();
+        return true;
+      }
+    }
+    return false;
+  }
+  return false;
+}
+
+bool GopCache::covered(qint64 anchor) const {
+  for (const Segment &seg : m_segments) {
+    if (!seg.frames.empty() && seg.frames.front().ms <= anchor &&
+        anchor < seg.coverEnd)
+      return true;
+  }
+  return false;
+}
+
+quint64 GopCache::request(qint64 anchor) {
+  if (covered(anchor))
+    return 0;
+  auto it = std::find_if(m_requests.begin(), m_requests.end(),
+                         [&](const Request &r) { return r.anchor == anchor; });
+  if (it != m_requests.end())
+    return it->id;
+  m_requests.push_back({anchor, ++m_nextId});
+  return m_nextId;
+}
+
+void GopCache::waitFor(quint64 id) {
+  if (!id)
+    return;
+  std::unique_lock<std::mutex> lk(m_mutex);
+  m_cond.wait(lk, [&] { return m_stop || m_doneId >= id; });
+}
+
+void GopCache::workerLoop() {
+  while (true) {
+    Request req;
+    {
+      std::unique_lock<std::mutex> lk(m_mutex);
+      m_cond.wait(lk, [&] { return m_stop || !m_requests.empty(); });
+      if (m_stop)
+        break;
+      req = m_requests.front();
+      m_requests.pop_front();
+      if (covered(req.anchor)) {
+        m_doneId = req.id;
+        lk.unlock();
+        m_cond.notify_all();
+        continue;
+      }
+    }
+    decodeSegment(req.anchor);
+    {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      m_doneId = req.id;
+    }
+    m_cond.notify_all();
+  }
+}
+
+void GopCache::decodeSegment(qint64 anchor) {
+  AVCodecContext *ctx = m_codecCtx.get();
+  int64_t ts = av_rescale_q(anchor, {1, 1000}, m_timeBase);
+  if (av_seek_frame(m_fmtCtx.get(), m_streamIndex, ts, AVSEEK_FLAG_BACKWARD) <
+      0) {
+    qWarning() << "GOP cache: seek failed at" << anchor << "ms";
+    return;
+  }
+  avcodec_flush_buffers(ctx);
+
+  Segment seg;
+  bool started = false;
+  bool full = false; // 超出预算且已越过目标帧
+  bool nextKey = false;
+  AVPacketPtr pkt = make_avpacket();
+  AVFramePtr frame = make_avframe();
+
+  auto receiveFrames = [&]() {
+    while (!full && avcodec_receive_frame(ctx, frame.get()) == 0) {
+      int64_t pts = frame->best_effort_timestamp;
+      if (pts == AV_NOPTS_VALUE)
+        pts = frame->pts;
+      qint64 ms = pts != AV_NOPTS_VALUE ? av_rescale_q(pts, m_timeBase, {1, 1000})
+                                        : -1;
+      // 开放 GOP 中早于关键帧的前导帧参考了上一个 GOP，丢弃
+      if (ms >= seg.keyMs) {
+        QSharedPointer<QImage> img = convert(frame.get());
+        if (img) {
+          seg.frames.push_back({ms, img});
+          seg.bytes += size_t(img->bytesPerLine()) * img->height();
+        }
+        // 超出预算：还没到目标时丢弃最早的帧，越过目标后停止
+        while (seg.bytes > m_segmentBytes && seg.frames.size() > 1) {
+          if (ms > anchor) {
+            full = true;
+            seg.coverEnd = ms + 1;
+            break;
+          }
+          const QImage &front = *seg.frames.front().image;
+          seg.bytes -= size_t(front.bytesPerLine()) * front.height();
+          seg.frames.pop_front();
+        }
+      }
+      av_frame_unref(frame.get());
+    }
+  };
+
+  while (!m_stop && !full) {
+    if (av_read_frame(m_fmtCtx.get(), pkt.get()) < 0) {
+      seg.eof = true;
+      break;
+    }
+    if (pkt->stream_index != m_streamIndex) {
+      av_packet_unref(pkt.get());
+      continue;
+    }
+    if (pkt->flags & AV_PKT_FLAG_KEY) {
+      int64_t pts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+      qint64 ms = av_rescale_q(pts, m_timeBase, {1, 1000});
+      if (!started || ms <= anchor) {
+        // 回退 seek 可能落在更早的 GOP，遇到不晚于目标的关键帧就从这里重新开始
+        avcodec_flush_buffers(ctx);
+        seg = Segment();
+        seg.keyMs = ms;
+        started = true;
+      } else {
+        seg.coverEnd = ms;
+        nextKey = true;
+        av_packet_unref(pkt.get());
+        break;
+      }
+    }
+    if (!started) {
+      av_packet_unref(pkt.get());
+      continue;
+    }
+    avcodec_send_packet(ctx, pkt.get());
+    av_packet_unref(pkt.get());
+    receiveFrames();
+  }
+
+  // 排空解码器里剩余的帧（B 帧重排）
+  if (!full) {
+    avcodec_send_packet(ctx, nullptr);
+    receiveFrames();
+  }
+  if (m_stop || seg.frames.empty())
+    return;
+  if (!full && !nextKey)
+    seg.coverEnd = seg.frames.back().ms + 1;
+
+  qCDebug(lcPlayer) << "GOP cache: decoded" << seg.frames.size() << "frames"
+                    << seg.frames.front().ms << "-" << seg.frames.back().ms
+                    << "ms for" << anchor << "ms," << seg.bytes / 1024 << "KB";
+  std::lock_guard<std::mutex> lk(m_mutex);
+  insertSegment(std::move(seg), anchor);
+}
+
+void GopCache::insertSegment(Segment &&seg, qint64 anchor) {
+  // 超出段数上限时淘汰离本次目标最远的一段
+  while (int(m_segments.size()) >= MAX_SEGMENTS) {
+    auto farthest = std::max_element(
+        m_segments.begin(), m_segments.end(),
+        [&](const Segment &a, const Segment &b) {
+          return std::llabs(a.keyMs - anchor) < std::llabs(b.keyMs - anchor);
+        });
+    m_segments.erase(farthest);
+  }
+  m_segments.push_back(std::move(seg));
+}
+
+QSharedPointer<QImage> GopCache::convert(const AVFrame *frame) {
+  int width = 0, height = 0;
+  fit_within(frame->width, frame->height, m_targetWidth, m_targetHeight, width,
+             height);
+
+  m_sws = sws_getCachedContext(m_sws, frame->width, frame->height,
+                               (AVPixelFormat)frame->format, width, height,
+                               AV_PIX_FMT_RGB24, SWS_BILINEAR, nullptr,
+                               nullptr, nullptr);
+  if (!m_sws)
+    return QSharedPointer<QImage>();
+
+  QSharedPointer<QImage> img(new QImage(width, height, QImage::Format_RGB888));
+  if (img->isNull())
+    return QSharedPointer<QImage>();
+  uint8_t *dst[1] = {img->bits()};
+  int dst_linesize[1] = {img->bytesPerLine()};
+  sws_scale(m_sws, frame->data, frame->linesize, 0, frame->height, dst,
+            dst_linesize);
+  return img;
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include "FFmpegUtils.h"
+#include <QImage>
+#include <QSharedPointer>
+#include <QString>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 逐帧步进与倒放使用的 GOP 解码缓存
+// 独立打开一份输入和视频解码器，按需把包含目标时间的整个 GOP 解码成 RGB
+// 图像保存下来，向后步进和倒放直接按相反顺序取帧。解码在后台线程进行，
+// 每次命中某个 GOP 时预取它前面的 GOP，倒放跨越 GOP 边界时不必停下等待。
+class GopCache {
+public:
+  struct Frame {
+    qint64 ms;
+    QSharedPointer<QImage> image;
+  };
+
+  explicit GopCache(size_t maxBytes);
+  ~GopCache();
+
+  // interrupt 为调用方的中断回调，关闭缓存时也会中断阻塞的网络读取
+  bool open(const QString &path, int streamIndex,
+            const AVIOInterruptCB *interrupt = nullptr);
+  void close();
+  bool isOpen() const { return m_open; }
+  int streamIndex() const { return m_streamIndex; }
+
+  // 输出图像不超过该尺寸（保持宽高比，只缩小不放大），0 表示原始尺寸
+  void setTargetSize(int width, int height);
+
+  // 早于 ms 的最后一帧 / 晚于 ms 的第一帧；缓存未命中时提交后台解码，
+  // wait 为 true 则等待解码完成后再查一次
+  bool frameBefore(qint64 ms, Frame &out, bool wait);
+  bool frameAfter(qint64 ms, Frame &out, bool wait);
+
+private:
+  // 一段连续解码结果，覆盖 [frames.front().ms, coverEnd) 内的所有帧
+  struct Segment {
+    qint64 keyMs = 0;    // 所属 GOP 的关键帧时间
+    qint64 coverEnd = 0; // 下一个关键帧时间；预算截断或文件末尾时为最后一帧 +1
+    std::deque<Frame> frames;
+    size_t bytes = 0;
+    bool eof = false; // 本段一直解码到了文件末尾
+  };
+  struct Request {
+    qint64 anchor;
+    quint64 id;
+  };
+
+  static const int MAX_SEGMENTS = 3;
+
+  void workerLoop();
+  void decodeSegment(qint64 anchor);
+  QSharedPointer<QImage> convert(const AVFrame *frame);
+  void waitFor(quint64 id);
+
+  // 以下函数均需持有 m_mutex；request 提交后由调用方在解锁后唤醒后台线程
+  bool covered(qint64 anchor) const;
+  quint64 request(qint64 anchor);
+  void insertSegment(Segment &&seg, qint64 anchor);
+  bool findBefore(qint64 ms, Frame &out, qint64 &prefetch) const;
+  bool findAfter(qint64 ms, Frame &out, qint64 &next) const;
+
+  size_t m_segmentBytes;
+  std::atomic<bool> m_open{false};
+  int m_streamIndex = -1;
+  AVRational m_timeBase = {1, 1000};
+  std::atomic<int> m_targetWidth{0};
+  std::atomic<int> m_targetHeight{0};
+
+  // 仅由后台线程使用
+  AVFormatContextPtr m_fmtCtx;
+  AVCodecContextPtr m_codecCtx;
+  SwsContext *m_sws = nullptr;
+
+  static int interrupted(void *opaque);
+  AVIOInterruptCB m_interrupt = {nullptr, nullptr};
+
+  std::thread m_worker;
+  std::atomic<bool> m_stop{false};
+  mutable std::mutex m_mutex;
+  std::condition_variable m_cond;
+  std::deque<Request> m_requests;
+  quint64 m_nextId = 0;
+  quint64 m_doneId = 0;
+  std::vector<Segment> m_segments;
+};
@@ -0,0 +1,497 @@
+#include "HttpCache.h"
+#include "MediaCache.h"
+#include "PlayerLog.h"
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSaveFile>
+#include <QUrl>
+#include <QtDebug>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+const quint32 INDEX_MAGIC = 0x48544350; // "HTCP"
+const quint32 INDEX_VERSION = 1;
+} // namespace
+
+std::atomic<qint64> HttpCache::s_startupBytes{1024 * 1024};
+std::atomic<qint64> HttpCache::s_rebufferBytes{512 * 1024};
+std::atomic<qint64> HttpCache::s_throughput{0};
+
+void HttpCache::setStartupBytes(qint64 bytes) {
+  s_startupBytes = std::max<qint64>(bytes, 1);
+}
+
+void HttpCache::setRebufferBytes(qint64 bytes) {
+  s_rebufferBytes = std::max<qint64>(bytes, 1);
+}
+
+qint64 HttpCache::throughput() { return s_throughput; }
+
+bool HttpCache::handles(const QString &url) {
+  QUrl u(url);
+  QString scheme = u.scheme().toLower();
+  if (scheme != "http" && scheme != "https")
+    return false;
+  QString path = u.path().toLower();
+  return !path.endsWith(".m3u8") && !path.endsWith(".m3u");
+}
+
+AVIOContext *HttpCache::create(const QString &url, bool startup,
+                               const AVIOInterruptCB *interrupt) {
+  std::shared_ptr<HttpCache> cache = acquire(url);
+  if (!cache)
+    return nullptr;
+  Reader *reader = new Reader;
+  reader->cache = cache;
+  reader->started = !startup;
+  if (interrupt)
+    reader->interrupt = *interrupt;
+  uint8_t *buffer = static_cast<uint8_t *>(av_malloc(IO_BUFFER_SIZE));
+  reader->ctx = buffer ? avio_alloc_context(buffer, IO_BUFFER_SIZE, 0, reader,
+                                            &HttpCache::readPacket, nullptr,
+                                            &HttpCache::seek)
+                       : nullptr;
+  if (!reader->ctx) {
+    av_free(buffer);
+    delete reader;
+    return nullptr;
+  }
+  return reader->ctx;
+}
+
+bool HttpCache::owns(const AVIOContext *pb) {
+  return pb && pb->read_packet == &HttpCache::readPacket;
+}
+
+void HttpCache::destroy(AVIOContext *pb) {
+  if (!owns(pb))
+    return;
+  Reader *reader = static_cast<Reader *>(pb->opaque);
+  {
+    std::lock_guard<std::mutex> lk(reader->cache->m_mutex);
+    reader->cache->m_readers.erase(reader);
+  }
+  av_freep(&pb->buffer);
+  av_freep(&pb);
+  delete reader; // 最后一个读者释放时关闭缓存
+}
+
+std::shared_ptr<HttpCache> HttpCache::acquire(const QString &url) {
+  static std::mutex mutex;
+  static std::map<QString, std::weak_ptr<HttpCache>> caches;
+  std::lock_guard<std::mutex> lk(mutex);
+  for (auto it = caches.begin(); it != caches.end();) {
+    if (it->second.expired())
+      it = caches.erase(it);
+    else
+      ++it;
+  }
+  std::weak_ptr<HttpCache> &entry = caches[url];
+  if (std::shared_ptr<HttpCache> cache = entry.lock())
+    return cache;
+  std::shared_ptr<HttpCache> cache(new HttpCache(url));
+  if (!cache->open()) {
+    caches.erase(url);
+    return nullptr;
+  }
+  entry = cache;
+  return cache;
+}
+
+HttpCache::HttpCache(const QString &url) : m_url(url) {}
+
+bool HttpCache::open() {
+  m_dataPath = MediaCache::urlFilePath(m_url, "http");
+  m_indexPath = m_dataPath + ".idx";
+  m_fd = ::open(m_dataPath.toUtf8().constData(), O_RDWR | O_CREAT | O_CLOEXEC,
+                0644);
+  if (m_fd < 0) {
+    qWarning() << "Network cache: cannot open" << m_dataPath;
+    return false;
+  }
+  if (loadIndex()) {
+    qint64 cached = 0;
+    for (const auto &range : m_ranges)
+      cached += range.second - range.first;
+    qCDebug(lcPlayer) << "Network cache:" << cached / 1024 << "KB of" << m_url
+                      << "already cached";
+    MediaCache::touch(m_dataPath);
+    MediaCache::touch(m_indexPath);
+  } else {
+    m_ranges.clear();
+    m_size = -1;
+    if (ftruncate(m_fd, 0) < 0)
+      return false;
+  }
+  m_chunk.resize(CHUNK_BYTES);
+  m_thread = std::thread(&HttpCache::downloadLoop, this);
+  return true;
+}
+
+HttpCache::~HttpCache() {
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_stop = true;
+  }
+  m_cond.notify_all();
+  if (m_thread.joinable())
+    m_thread.join();
+  closeUpstream();
+  if (m_dirty)
+    saveIndex();
+  if (m_fd >= 0)
+    ::close(m_fd);
+  MediaCache::trim();
+}
+
+int HttpCache::readPacket(void *opaque, uint8_t *buf, int size) {
+  Reader *reader = static_cast<Reader *>(opaque);
+  HttpCache *cache = reader->cache.get();
+  qint64 avail = cache->waitAvailable(reader);
+  if (avail < 0)
+    return int(avail);
+  if (avail == 0)
+    return AVERROR_EOF;
+  ssize_t n = pread(cache->m_fd, buf, size_t(std::min<qint64>(size, avail)),
+                    reader->pos);
+  if (n <= 0)
+    return AVERROR(EIO);
+  reader->pos += n;
+  return int(n);
+}
+
+int64_t HttpCache::seek(void *opaque, int64_t offset, int whence) {
+  Reader *reader = static_cast<Reader *>(opaque);
+  qint64 size = 0;
+  {
+    std::lock_guard<std::mutex> lk(reader->cache->m_mutex);
+    size = reader->cache->m_size;
+  }
+  if (whence & AVSEEK_SIZE)
+    return size >= 0 ? size : AVERROR(ENOSYS);
+  switch (whence & ~AVSEEK_FORCE) {
+  case SEEK_SET:
+    break;
+  case SEEK_CUR:
+    offset += reader->pos;
+    break;
+  case SEEK_END:
+    if (size < 0)
+      return AVERROR(ENOSYS);
+    offset += size;
+    break;
+  default:
+    return AVERROR(EINVAL);
+  }
+  if (offset < 0)
+    return AVERROR(EINVAL);
+  reader->pos = offset;
+  return offset;
+}
+
+int HttpCache::interrupted(void *opaque) {
+  // 上游连接由所有读者共享，不跟随某个读者的中断；读者都关闭后缓存随之析构，
+  // 在这里中断阻塞的下载
+  return static_cast<HttpCache *>(opaque)->m_stop ? 1 : 0;
+}
+
+qint64 HttpCache::cachedFrom(qint64 pos) const {
+  auto it = m_ranges.upper_bound(pos);
+  if (it == m_ranges.begin())
+    return 0;
+  --it;
+  return it->second > pos ? it->second - pos : 0;
+}
+
+void HttpCache::addRange(qint64 begin, qint64 end) {
+  // 与相交或相邻的区间合并
+  auto it = m_ranges.upper_bound(begin);
+  if (it != m_ranges.begin() && std::prev(it)->second >= begin)
+    --it;
+  while (it != m_ranges.end() && it->first <= end) {
+    begin = std::min(begin, it->first);
+    end = std::max(end, it->second);
+    it = m_ranges.erase(it);
+  }
+  m_ranges[begin] = end;
+}
+
+qint64 HttpCache::readAheadBytes() const {
+  // 窗口不小于缓冲阈值，否则等待阈值的读者永远等不到
+  return std::max(READAHEAD_BYTES,
+                  std::max(s_startupBytes.load(), s_rebufferBytes.load()));
+}
+
+bool HttpCache::nextFetch(qint64 &pos) const {
+  qint64 leastAhead = readAheadBytes();
+  bool found = false;
+  for (const auto &reader : m_readers) {
+    qint64 ahead = cachedFrom(reader.second);
+    qint64 end = reader.second + ahead;
+    if ((m_size >= 0 && end >= m_size) || end == m_failedPos)
+      continue;
+    if (ahead < leastAhead) {
+      leastAhead = ahead;
+      pos = end;
+      found = true;
+    }
+  }
+  return found;
+}
+
+void HttpCache::dropRange(qint64 begin, qint64 end) {
+  // 从索引中去掉 [begin, end)，并在缓存文件中打洞归还磁盘空间
+  auto it = m_ranges.upper_bound(begin);
+  if (it == m_ranges.begin())
+    return;
+  --it;
+  qint64 rangeBegin = it->first;
+  qint64 rangeEnd = it->second;
+  m_ranges.erase(it);
+  if (rangeBegin < begin)
+    m_ranges[rangeBegin] = begin;
+  if (end < rangeEnd)
+    m_ranges[end] = rangeEnd;
+#ifdef FALLOC_FL_PUNCH_HOLE
+  if (fallocate(m_fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, begin,
+                end - begin) < 0)
+    qCDebug(lcPlayer) << "Network cache: punching hole failed at" << begin;
+#endif
+}
+
+bool HttpCache::evictRanges() {
+  qint64 excess = -MAX_CACHED_BYTES;
+  for (const auto &range : m_ranges)
+    excess += range.second - range.first;
+  if (excess <= 0 || m_readers.empty())
+    return false;
+
+  // 读者附近的数据保留：最靠前的读位置之前 KEEP_BEHIND_BYTES（短距离回退），
+  // 最靠后的读位置之后一个下载窗口（正在读取和即将读取的数据）
+  qint64 minPos = m_readers.begin()->second;
+  qint64 maxPos = minPos;
+  for (const auto &reader : m_readers) {
+    minPos = std::min(minPos, reader.second);
+    maxPos = std::max(maxPos, reader.second);
+  }
+  const qint64 behind = minPos - KEEP_BEHIND_BYTES;
+  const qint64 ahead = maxPos + readAheadBytes();
+  qint64 freed = 0;
+
+  // 先释放最早的、早已读过的数据
+  while (excess > 0 && !m_ranges.empty() && m_ranges.begin()->first < behind) {
+    qint64 begin = m_ranges.begin()->first;
+    qint64 end = std::min({m_ranges.begin()->second, behind, begin + excess});
+    dropRange(begin, end);
+    excess -= end - begin;
+    freed += end - begin;
+  }
+  // 仍超出时释放此前跳转留下的、远在读位置之后的区间
+  while (excess > 0 && !m_ranges.empty() &&
+         std::prev(m_ranges.end())->second > ahead) {
+    qint64 end = std::prev(m_ranges.end())->second;
+    qint64 begin = std::max(
+        {std::prev(m_ranges.end())->first, ahead, end - excess});
+    dropRange(begin, end);
+    excess -= end - begin;
+    freed += end - begin;
+  }
+  if (freed > 0)
+    qCDebug(lcPlayer) << "Network cache: released" << freed / 1024
+                      << "KB of" << m_url;
+  return freed > 0;
+}
+
+qint64 HttpCache::waitAvailable(Reader *reader) {
+  std::unique_lock<std::mutex> lk(m_mutex);
+  const qint64 pos = reader->pos;
+  m_readers[reader] = pos;
+  qint64 avail = cachedFrom(pos);
+  if (avail == 0 && !(m_size >= 0 && pos >= m_size)) {
+    // 下载失败的位置不再重试，直接报错
+    if (m_failedPos == pos)
+      return m_error;
+    // 缓存读完：下载够阈值再继续，避免一小块一小块地卡顿
+    const qint64 need = reader->started ? s_rebufferBytes : s_startupBytes;
+    QElapsedTimer timer;
+    timer.start();
+    m_cond.notify_all();
+    auto ready = [&] {
+      avail = cachedFrom(pos);
+      qint64 want = m_size >= 0 ? std::min(need, m_size - pos) : need;
+      return m_stop || m_failedPos == pos + avail || avail >= want;
+    };
+    // 服务器卡住时下载可能一直不返回，定时检查读者的中断回调
+    while (!m_cond.wait_for(lk, std::chrono::milliseconds(INTERRUPT_POLL_MS),
+                            ready)) {
+      const AVIOInterruptCB &cb = reader->interrupt;
+      if (cb.callback && cb.callback(cb.opaque)) {
+        qCDebug(lcPlayer) << "Network: read interrupted at" << pos;
+        return AVERROR_EXIT;
+      }
+    }
+    qCDebug(lcPlayer) << "Network:"
+                      << (reader->started ? "rebuffered" : "buffered")
+                      << avail / 1024 << "KB at" << pos << "in"
+                      << timer.elapsed() << "ms";
+  }
+  reader->started = true;
+  m_cond.notify_all(); // 读位置前移，下载线程可能需要继续
+  if (avail > 0)
+    return avail;
+  return m_failedPos == pos ? m_error : 0;
+}
+
+int HttpCache::fetchChunk(qint64 pos, qint64 &begin) {
+  for (;;) {
+    if (!m_upstream) {
+      AVIOInterruptCB cb = {&HttpCache::interrupted, this};
+      int ret = avio_open2(&m_upstream, m_url.toUtf8().constData(),
+                           AVIO_FLAG_READ, &cb, nullptr);
+      if (ret < 0) {
+        qWarning() << "Network cache: failed to open" << m_url;
+        m_upstream = nullptr;
+        return ret;
+      }
+      m_upstreamPos = 0;
+      qint64 size = avio_size(m_upstream);
+      std::lock_guard<std::mutex> lk(m_mutex);
+      if (size > 0) {
+        if (m_size >= 0 && m_size != size) {
+          qCDebug(lcPlayer) << "Network cache: remote size changed, dropping"
+                            << m_url;
+          m_ranges.clear();
+          if (ftruncate(m_fd, 0) < 0)
+            return AVERROR(EIO);
+        }
+        m_size = size;
+      }
+    }
+    if (m_upstreamPos == pos)
+      break;
+    if (avio_seek(m_upstream, pos, SEEK_SET) >= 0) {
+      m_upstreamPos = pos;
+      break;
+    }
+    if (pos > m_upstreamPos)
+      break; // 不支持 Range：顺序读到目标位置
+    // 不支持 Range 又要往回读：从头重新连接（新连接从 0 开始，最多再循环一次）
+    closeUpstream();
+  }
+  // 服务器不支持 Range 时顺序读到目标位置，途经的数据一并缓存
+  begin = m_upstreamPos;
+  int want = begin < pos ? int(std::min<qint64>(CHUNK_BYTES, pos - begin))
+                         : CHUNK_BYTES;
+  QElapsedTimer timer;
+  timer.start();
+  int n = avio_read(m_upstream, m_chunk.data(), want);
+  if (n > 0) {
+    // 下载线程只在领先窗口未满时读取，读取耗时反映的就是链路速率；
+    // 单块可能直接来自套接字缓冲，累计够一段时间再计入
+    m_rateBytes += n;
+    m_rateNsecs += timer.nsecsElapsed();
+    if (m_rateNsecs >= RATE_WINDOW_NSECS) {
+      qint64 rate = m_rateBytes * 8 * 1000000000LL / m_rateNsecs;
+      qint64 last = s_throughput;
+      s_throughput = last > 0 ? (last * 3 + rate) / 4 : rate;
+      m_rateBytes = m_rateNsecs = 0;
+    }
+    if (pwrite(m_fd, m_chunk.data(), size_t(n), begin) != n)
+      return AVERROR(EIO);
+    m_upstreamPos += n;
+  } else if (n != AVERROR_EOF) {
+    closeUpstream();
+  }
+  return n;
+}
+
+void HttpCache::closeUpstream() {
+  if (m_upstream)
+    avio_closep(&m_upstream);
+}
+
+void HttpCache::downloadLoop() {
+  std::unique_lock<std::mutex> lk(m_mutex);
+  while (!m_stop) {
+    qint64 pos = 0;
+    m_cond.wait(lk, [&] { return m_stop || nextFetch(pos); });
+    if (m_stop)
+      break;
+    lk.unlock();
+    qint64 begin = pos;
+    int n = fetchChunk(pos, begin);
+    lk.lock();
+    if (n > 0) {
+      addRange(begin, begin + n);
+      if (m_failedPos >= begin && m_failedPos < begin + n)
+        m_failedPos = -1;
+      m_dirty = true;
+      // 边下载边控制缓存大小，不等到关闭时才整理；释放区间后立即保存索引，
+      // 否则异常退出后索引会指向已打洞的数据
+      m_sinceTrim += n;
+      if (m_sinceTrim >= TRIM_INTERVAL_BYTES) {
+        m_sinceTrim = 0;
+        if (evictRanges())
+          saveIndex();
+        lk.unlock();
+        MediaCache::trim();
+        lk.lock();
+      }
+    } else if (n == 0 || n == AVERROR_EOF) {
+      m_size = begin; // 实际的文件末尾
+      m_dirty = true;
+    } else if (!m_stop) {
+      qWarning() << "Network cache: read error" << n << "at" << pos;
+      m_failedPos = pos;
+      m_error = n;
+    }
+    m_cond.notify_all();
+  }
+}
+
+bool HttpCache::loadIndex() {
+  QFile file(m_indexPath);
+  if (!file.open(QIODevice::ReadOnly))
+    return false;
+  QDataStream in(&file);
+  quint32 magic = 0, version = 0, count = 0;
+  qint64 size = -1;
+  in >> magic >> version >> size >> count;
+  if (magic != INDEX_MAGIC || version != INDEX_VERSION)
+    return false;
+  std::map<qint64, qint64> ranges;
+  for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; i++) {
+    qint64 begin = 0, end = 0;
+    in >> begin >> end;
+    if (begin >= end)
+      return false;
+    ranges[begin] = end;
+  }
+  if (in.status() != QDataStream::Ok)
+    return false;
+  // 数据文件可能已被缓存淘汰删掉或截断
+  struct stat st;
+  if (fstat(m_fd, &st) < 0 ||
+      (!ranges.empty() && ranges.rbegin()->second > st.st_size))
+    return false;
+  m_size = size;
+  m_ranges.swap(ranges);
+  return true;
+}
+
+void HttpCache::saveIndex() const {
+  QSaveFile file(m_indexPath);
+  if (!file.open(QIODevice::WriteOnly))
+    return;
+  QDataStream out(&file);
+  out << INDEX_MAGIC << INDEX_VERSION << m_size << quint32(m_ranges.size());
+  for (const auto &range : m_ranges)
+    out << range.first << range.second;
+  if (!file.commit())
+    qWarning() << "Network cache: failed to write index" << m_indexPath;
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include "FFmpegUtils.h"
+#include "MediaCache.h"
+#include <QString>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// HTTP/HTTPS 输入的磁盘字节区间缓存
+// 读取穿透缓存：已下载的区间直接从缓存文件读，缺少的由后台下载线程从读位置开始
+// 向前下载并写入缓存文件。同一 URL 的多个读者（视频、音频线程各一个）共享一份
+// 缓存和一条下载连接。区间索引随缓存文件保存，重看或在已下载范围内跳转不再产生
+// 网络读取。服务器不支持 Range 请求时顺序读到跳转目标，途经的数据照样缓存。
+// 长时间播放时边下载边控制缓存大小：单个地址的缓存超出预算后，从离读位置最远的
+// 区间开始在缓存文件中打洞释放，并同时淘汰缓存目录中的其他文件。
+class HttpCache {
+public:
+  // http(s) 地址且不是 HLS 播放列表（播放列表会变化，不缓存）
+  static bool handles(const QString &url);
+
+  // 为 url 创建带缓存的 AVIOContext，与 AVFMT_FLAG_CUSTOM_IO 一起使用；
+  // startup 为 true 时第一次读取按起播阈值缓冲，否则按卡顿后的重新缓冲阈值。
+  // FFmpeg 不会对自定义 I/O 的读取调用中断回调，interrupt 由这里在等待下载时
+  // 检查，返回非 0 时读取返回 AVERROR_EXIT
+  static AVIOContext *create(const QString &url, bool startup,
+                             const AVIOInterruptCB *interrupt = nullptr);
+  static void destroy(AVIOContext *pb);
+  static bool owns(const AVIOContext *pb);
+
+  // 起播 / 卡顿后重新缓冲时，读取前至少要下载好的字节数（到文件末尾为止）
+  static void setStartupBytes(qint64 bytes);
+  static void setRebufferBytes(qint64 bytes);
+
+  // 最近的下载速率（bit/s，所有连接平滑后的值），还没有下载过时为 0
+  static qint64 throughput();
+
+  ~HttpCache();
+
+private:
+  struct Reader {
+    std::shared_ptr<HttpCache> cache;
+    qint64 pos = 0; // 当前读位置，仅由该读者的解复用线程访问
+    bool started = false;
+    AVIOContext *ctx = nullptr;
+    AVIOInterruptCB interrupt = {nullptr, nullptr};
+  };
+
+  static const int IO_BUFFER_SIZE = 64 * 1024;
+  static const int CHUNK_BYTES = 64 * 1024;              // 每次下载的块
+  static const qint64 READAHEAD_BYTES = 4 * 1024 * 1024; // 领先读位置的下载量
+  static const qint64 RATE_WINDOW_NSECS = 500000000;     // 下载速率统计窗口
+  static const int INTERRUPT_POLL_MS = 100; // 等待下载时检查中断回调的间隔
+  static const qint64 TRIM_INTERVAL_BYTES = 16 * 1024 * 1024; // 检查预算的间隔
+  static const qint64 KEEP_BEHIND_BYTES = 32 * 1024 * 1024; // 读位置之前保留
+  // 单个地址的缓存预算，留出一半给缓存目录中的其他数据
+  static const qint64 MAX_CACHED_BYTES = MediaCache::DEFAULT_MAX_BYTES / 2;
+
+  explicit HttpCache(const QString &url);
+  static std::shared_ptr<HttpCache> acquire(const QString &url);
+  bool open();
+
+  static int readPacket(void *opaque, uint8_t *buf, int size);
+  static int64_t seek(void *opaque, int64_t offset, int whence);
+  static int interrupted(void *opaque); // 上游连接的中断回调：缓存关闭时中断
+
+  // 以下需持有 m_mutex
+  qint64 cachedFrom(qint64 pos) const; // pos 起连续已缓存的字节数
+  void addRange(qint64 begin, qint64 end);
+  bool nextFetch(qint64 &pos) const; // 领先最少的读者之后第一个未缓存的位置
+  qint64 readAheadBytes() const;     // 领先读位置的下载窗口
+  bool evictRanges(); // 超出预算时释放远离读者的区间，有释放时返回 true
+  void dropRange(qint64 begin, qint64 end);
+
+  qint64 waitAvailable(Reader *reader);
+  int fetchChunk(qint64 pos, qint64 &begin);
+  void closeUpstream();
+  void downloadLoop();
+  bool loadIndex();
+  void saveIndex() const;
+
+  static std::atomic<qint64> s_startupBytes;
+  static std::atomic<qint64> s_rebufferBytes;
+  static std::atomic<qint64> s_throughput;
+
+  QString m_url;
+  QString m_dataPath;
+  QString m_indexPath;
+  int m_fd = -1;
+
+  // 仅由下载线程使用
+  AVIOContext *m_upstream = nullptr;
+  qint64 m_upstreamPos = 0;
+  std::vector<uint8_t> m_chunk;
+  qint64 m_rateBytes = 0; // 当前统计窗口内下载的字节数与读取耗时
+  qint64 m_rateNsecs = 0;
+  qint64 m_sinceTrim = 0; // 上次检查预算以来下载的字节数
+
+  std::thread m_thread;
+  std::atomic<bool> m_stop{false};
+  mutable std::mutex m_mutex;
+  std::condition_variable m_cond;
+  qint64 m_size = -1;                // 未知为 -1
+  std::map<qint64, qint64> m_ranges; // 已缓存区间，起点 -> 终点，互不相邻
+  std::map<const Reader *, qint64> m_readers; // 各读者的读位置
+  // 下载失败的位置（-1 表示没有）：不再向该处发起下载，读者读到该处直接返回
+  // m_error；其他位置照常下载，之后的下载覆盖到该处时清除
+  qint64 m_failedPos = -1;
+  int m_error = 0;
+  bool m_dirty = false;
+};
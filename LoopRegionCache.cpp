@@ -0,0 +1,135 @@
+#include "LoopRegionCache.h"
+#include <algorithm>
+
+LoopRegionCache::LoopRegionCache(size_t maxBytes) : m_maxBytes(maxBytes) {}
+
+void LoopRegionCache::reset(qint64 startMs, qint64 endMs) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  dropAll();
+  m_overflowed = false;
+  m_start = startMs;
+  m_end = endMs;
+  m_active = true;
+}
+
+void LoopRegionCache::clear() {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_active = false;
+  dropAll();
+  m_overflowed = false;
+  m_videoCond.notify_all();
+}
+
+void LoopRegionCache::beginPass(bool fromStart) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  // 超出过上限的区间不再尝试缓存，避免每一轮都重复分配
+  State next = (fromStart && !m_overflowed) ? State::Recording : State::Idle;
+  if (m_audioState != State::Complete) {
+    m_audio.clear();
+    m_audioState = next;
+  }
+  if (m_videoState != State::Complete) {
+    m_video.clear();
+    m_videoState = next;
+  }
+  m_bytes = 0;
+  for (const AudioChunk &c : m_audio)
+    m_bytes += c.pcm.size();
+  for (const VideoFrame &f : m_video)
+    m_bytes += f.image ? f.image->sizeInBytes() : 0;
+}
+
+void LoopRegionCache::addAudio(qint64 ms, const QByteArray &pcm) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  if (m_audioState != State::Recording)
+    return;
+  // pcm 可能直接引用重采样缓冲区，这里做深拷贝
+  m_audio.append({ms, QByteArray(pcm.constData(), pcm.size())});
+  m_bytes += pcm.size();
+  checkBudget();
+}
+
+void LoopRegionCache::addVideo(qint64 ms, const QSharedPointer<QImage> &image) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  if (m_videoState != State::Recording || !image)
+    return;
+  m_video.append({ms, image});
+  m_bytes += image->sizeInBytes();
+  checkBudget();
+}
+
+void LoopRegionCache::finishAudio() {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  if (m_audioState == State::Recording)
+    m_audioState = State::Complete;
+}
+
+void LoopRegionCache::finishVideo() {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  if (m_videoState == State::Recording)
+    m_videoState = State::Complete;
+  m_videoCond.notify_all();
+}
+
+bool LoopRegionCache::audioReady() const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  return m_audioState == State::Complete && !m_audio.isEmpty();
+}
+
+bool LoopRegionCache::videoReady() const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  return m_videoState == State::Complete;
+}
+
+bool LoopRegionCache::waitVideoReady(std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> lk(m_mutex);
+  return m_videoCond.wait_for(lk, timeout, [&] {
+    return m_videoState == State::Complete || m_videoState == State::Idle ||
+           !m_active;
+  }) && m_videoState == State::Complete;
+}
+
+bool LoopRegionCache::overflowed() const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  return m_overflowed;
+}
+
+bool LoopRegionCache::audioChunk(int idx, AudioChunk &out) const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  if (idx < 0 || idx >= m_audio.size())
+    return false;
+  out = m_audio[idx];
+  return true;
+}
+
+bool LoopRegionCache::videoFrame(int idx, VideoFrame &out) const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  if (idx < 0 || idx >= m_video.size())
+    return false;
+  out = m_video[idx];
+  return true;
+}
+
+int LoopRegionCache::videoIndexAt(qint64 ms) const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  auto it = std::upper_bound(
+      m_video.begin(), m_video.end(), ms,
+      [](qint64 t, const VideoFrame &f) { return t < f.ms; });
+  return int(it - m_video.begin()) - 1;
+}
+
+void LoopRegionCache::dropAll() {
+  m_audio.clear();
+  m_video.clear();
+  m_bytes = 0;
+  m_audioState = State::Idle;
+  m_videoState = State::Idle;
+}
+
+void LoopRegionCache::checkBudget() {
+  if (m_bytes <= m_maxBytes)
+    return;
+  dropAll();
+  m_overflowed = true;
+  m_videoCond.notify_all();
+}
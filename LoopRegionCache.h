@@ -0,0 +1,72 @@
+#pragma once
+#include <QByteArray>
+#include <QImage>
+#include <QSharedPointer>
+#include <QVector>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+// A-B 循环区间及其解码结果缓存
+// 第一遍播放区间时记录重采样后的 PCM 和转换后的视频帧，
+// 总量不超过内存上限时后续每一轮直接从缓存重放；超出上限则放弃缓存，
+// 由解码器在到达 B 点时回到 A 点重新解码。这时没有提前定位好的第二路解复用器，
+// 回绕处仍有一次 seek 的间隙（回退缓冲区命中时只省去文件读取）。
+class LoopRegionCache {
+public:
+  struct AudioChunk {
+    qint64 ms;
+    QByteArray pcm;
+  };
+  struct VideoFrame {
+    qint64 ms;
+    QSharedPointer<QImage> image;
+  };
+
+  explicit LoopRegionCache(size_t maxBytes);
+
+  void reset(qint64 startMs, qint64 endMs); // 设定新区间并清空缓存
+  void clear();                             // 取消循环
+
+  bool active() const { return m_active; }
+  qint64 start() const { return m_start; }
+  qint64 end() const { return m_end; }
+
+  // 开始新一轮播放；只有从 A 点开始的一轮才会记录，保证缓存连续
+  void beginPass(bool fromStart);
+
+  void addAudio(qint64 ms, const QByteArray &pcm);
+  void addVideo(qint64 ms, const QSharedPointer<QImage> &image);
+  void finishAudio();
+  void finishVideo();
+
+  bool audioReady() const;
+  bool videoReady() const;
+  bool waitVideoReady(std::chrono::milliseconds timeout);
+  bool overflowed() const;
+
+  bool audioChunk(int idx, AudioChunk &out) const;
+  bool videoFrame(int idx, VideoFrame &out) const;
+  int videoIndexAt(qint64 ms) const; // 不晚于 ms 的最后一帧，没有则为 -1
+
+private:
+  enum class State { Idle, Recording, Complete };
+
+  void dropAll(); // 需持有 m_mutex
+  void checkBudget();
+
+  mutable std::mutex m_mutex;
+  std::condition_variable m_videoCond;
+  std::atomic<bool> m_active{false};
+  std::atomic<qint64> m_start{0};
+  std::atomic<qint64> m_end{0};
+
+  size_t m_maxBytes;
+  size_t m_bytes = 0;
+  bool m_overflowed = false;
+  State m_audioState = State::Idle;
+  State m_videoState = State::Idle;
+  QVector<AudioChunk> m_audio;
+  QVector<VideoFrame> m_video;
+};
@@ -6,12 +6,19 @@
 #include <QFontMetrics>
 #include <QTimer>
 
-LyricRenderer::LyricRenderer(LyricManager *manager) : lyricManager(manager) {}
+LyricRenderer::LyricRenderer(LyricManager *manager, TextCueCache *cueCache)
+    : lyricManager(manager), cueCache(cueCache) {}
 
 void LyricRenderer::drawLyricsByTime(QPainter &p, const QRect &lyricRect,
                                      int overlayFontSize, qint64 currentTime) {
   // 获取当前歌词
   LyricLine currentLyric = lyricManager->getCurrentLyric(currentTime);
+  int pointSize = overlayFontSize - 2;
+  if (currentLyric.time != lastLyricTime) {
+    // 歌词切换时在后台预渲染接下来的几行
+    lastLyricTime = currentLyric.time;
+    prefetchUpcoming(currentTime, pointSize, lyricRect.width());
+  }
 
   if (currentLyric.text.isEmpty()) {
     return;
@@ -44,27 +51,28 @@ void LyricRenderer::drawLyricsByTime(QPainter &p, const QRect &lyricRect,
     return;
   }
 
-  // 绘制歌词
-  QFont lyricFont("Microsoft YaHei", overlayFontSize - 2, QFont::Bold);
-  p.setFont(lyricFont);
-  QRect textRect = p.fontMetrics().boundingRect(
-      lyricRect, Qt::AlignHCenter | Qt::AlignVCenter, lyricText);
-  textRect = textRect.marginsAdded(QMargins(10, 8, 10, 8));
+  // 绘制歌词：文字和背景已渲染好，淡入淡出只改贴图透明度
+  QImage cue = cueCache->cue(lyricText, pointSize, lyricRect.width());
+  if (cue.isNull() || alpha <= 0) {
+    return;
+  }
+  QRect textRect(QPoint(0, 0), cue.size());
   textRect.moveCenter(lyricRect.center());
 
-  // 绘制背景
   p.save();
-  p.setRenderHint(QPainter::Antialiasing, true);
-  QColor bgColor(0, 0, 0, 180 * alpha / 255);
-  p.setPen(Qt::NoPen);
-  p.setBrush(bgColor);
-  p.drawRoundedRect(textRect, 12, 12);
+  p.setOpacity(alpha / 255.0);
+  p.drawImage(textRect.topLeft(), cue);
   p.restore();
+}
 
-  // 绘制文本
-  p.save();
-  QColor textColor(255, 255, 255, alpha);
-  p.setPen(textColor);
-  p.drawText(textRect, Qt::AlignHCenter | Qt::AlignVCenter, lyricText);
-  p.restore();
+void LyricRenderer::prefetchUpcoming(qint64 currentTime, int pointSize,
+                                     int width) {
+  const QVector<LyricLine> &lyrics = lyricManager->getLyrics();
+  int queued = 0;
+  for (int i = 0; i < lyrics.size() && queued < PREFETCH_LINES; ++i) {
+    if (lyrics[i].time > currentTime) {
+      cueCache->prefetch(lyrics[i].text, pointSize, width);
+      ++queued;
+    }
+  }
 }
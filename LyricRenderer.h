@@ -1,5 +1,6 @@
 #pragma once
 #include "LyricManager.h"
+#include "TextCueCache.h"
 #include <QElapsedTimer>
 #include <QPainter>
 #include <QRect>
@@ -8,11 +9,16 @@ class LyricManager; // 前置声明
 
 class LyricRenderer {
 public:
-  LyricRenderer(LyricManager *manager);
+  LyricRenderer(LyricManager *manager, TextCueCache *cueCache);
 
   void drawLyricsByTime(QPainter &p, const QRect &lyricRect,
                         int overlayFontSize, qint64 currentTime);
 
 private:
+  static const int PREFETCH_LINES = 2; // 歌词切换时预渲染的后续行数
+  void prefetchUpcoming(qint64 currentTime, int pointSize, int width);
+
   LyricManager *lyricManager;
+  TextCueCache *cueCache;
+  qint64 lastLyricTime = -1; // 上次绘制时当前歌词的开始时间
 };
@@ -0,0 +1,83 @@
+#include "MediaCache.h"
+#include "PlayerLog.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+// 文件实际占用的磁盘空间：网络缓存是打过洞的稀疏文件，不能按文件长度计算
+qint64 disk_usage(const QFileInfo &info) {
+#ifdef __linux__
+  struct stat st;
+  if (stat(QFile::encodeName(info.absoluteFilePath()).constData(), &st) == 0)
+    return qint64(st.st_blocks) * 512;
+#endif
+  return info.size();
+}
+} // namespace
+
+QString MediaCache::dir() {
+  QString path = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+  if (path.isEmpty())
+    path = QDir::tempPath() + "/NewPlayer-cache";
+  QDir().mkpath(path);
+  return path;
+}
+
+QString MediaCache::filePath(const QString &mediaPath, const QString &suffix) {
+  QFileInfo info(mediaPath);
+  QByteArray key = info.absoluteFilePath().toUtf8();
+  key += '|' + QByteArray::number(info.size());
+  key += '|' + QByteArray::number(info.lastModified().toMSecsSinceEpoch());
+  QByteArray hash = QCryptographicHash::hash(key, QCryptographicHash::Sha1);
+  return QDir(dir()).filePath(QString::fromLatin1(hash.toHex()) + "." + suffix);
+}
+
+QString MediaCache::urlFilePath(const QString &url, const QString &suffix) {
+  QByteArray hash =
+      QCryptographicHash::hash(url.toUtf8(), QCryptographicHash::Sha1);
+  return QDir(dir()).filePath(QString::fromLatin1(hash.toHex()) + "." + suffix);
+}
+
+void MediaCache::touch(const QString &cachePath) {
+  QFile file(cachePath);
+  if (file.open(QIODevice::ReadWrite))
+    file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+}
+
+void MediaCache::trim(qint64 maxBytes) {
+  // 按修改时间从新到旧排列，累计超出上限的部分全部删除
+  QDir cacheDir(dir());
+  QFileInfoList files = cacheDir.entryInfoList(QDir::Files, QDir::Time);
+  qint64 total = 0;
+  for (const QFileInfo &info : files) {
+    total += disk_usage(info);
+    if (total > maxBytes) {
+      qCDebug(lcPlayer) << "Media cache: evicting" << info.fileName();
+      cacheDir.remove(info.fileName());
+    }
+  }
+}
+
+void MediaCache::setBackgroundPriority() {
+#ifdef __linux__
+  const int IOPRIO_WHO_PROCESS = 1;
+  const int IOPRIO_CLASS_IDLE = 3;
+  const int IOPRIO_CLASS_SHIFT = 13;
+  // 两者作用于调用线程（who 为 0 / 线程 ID）
+  if (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0,
+              IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT) < 0)
+    qCDebug(lcPlayer) << "Media cache: ioprio_set failed";
+  setpriority(PRIO_PROCESS, pid_t(syscall(SYS_gettid)), 10);
+#endif
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <QString>
+
+// 媒体派生数据（跳转索引等）的磁盘缓存
+// 缓存文件以 “源文件路径 + 大小 + 修改时间” 的哈希命名，源文件变化后自动失效；
+// 目录总大小超出上限时按最近使用时间淘汰。
+class MediaCache {
+public:
+  // 缓存目录，不存在时创建
+  static QString dir();
+
+  // 源文件对应的缓存文件路径，suffix 区分不同种类的数据
+  static QString filePath(const QString &mediaPath, const QString &suffix);
+
+  // 网络地址对应的缓存文件路径（只按地址区分，内容变化由调用方检测）
+  static QString urlFilePath(const QString &url, const QString &suffix);
+
+  // 标记缓存文件刚被使用过（LRU 依据）
+  static void touch(const QString &cachePath);
+
+  // 目录总大小超过 maxBytes 时删除最久未使用的文件
+  static void trim(qint64 maxBytes = DEFAULT_MAX_BYTES);
+
+  // 生成缓存的后台线程调用：I/O 优先级降为 idle，CPU 优先级调低，不影响播放
+  static void setBackgroundPriority();
+
+  static const qint64 DEFAULT_MAX_BYTES = 512LL * 1024 * 1024;
+};
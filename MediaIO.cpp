@@ -0,0 +1,229 @@
+#include "MediaIO.h"
+#include "HttpCache.h"
+#include "PlayerLog.h"
+#include <QFileInfo>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+std::atomic<qint64> MediaIO::s_readaheadBytes{8 * 1024 * 1024};
+std::atomic<int> MediaIO::s_latencyMs{0};
+int (*MediaIO::s_defaultOpen)(AVFormatContext *, AVIOContext **, const char *,
+                              int, AVDictionary **) = nullptr;
+void (*MediaIO::s_defaultClose)(AVFormatContext *, AVIOContext *) = nullptr;
+
+void MediaIO::setReadaheadBytes(qint64 bytes) {
+  s_readaheadBytes = std::max<qint64>(bytes, CHUNK_BYTES);
+}
+
+void MediaIO::setInjectedLatency(int ms) { s_latencyMs = std::max(ms, 0); }
+
+AVIOContext *MediaIO::create(const QString &path,
+                             const AVIOInterruptCB *interrupt) {
+  if (HttpCache::handles(path))
+    return HttpCache::create(path, true, interrupt);
+  if (!QFileInfo(path).isFile())
+    return nullptr;
+  MediaIO *io = new MediaIO;
+  if (!io->open(path)) {
+    delete io;
+    return nullptr;
+  }
+  return io->m_ctx;
+}
+
+void MediaIO::destroy(AVIOContext *pb) {
+  if (pb && pb->read_packet == &MediaIO::readPacket)
+    delete static_cast<MediaIO *>(pb->opaque);
+  else
+    HttpCache::destroy(pb);
+}
+
+int MediaIO::openInput(AVFormatContext **ctx, const QString &path,
+                       AVDictionary **options,
+                       const AVIOInterruptCB *interrupt) {
+  *ctx = avformat_alloc_context();
+  if (!*ctx)
+    return AVERROR(ENOMEM);
+  installHooks(*ctx);
+  if (interrupt)
+    (*ctx)->interrupt_callback = *interrupt;
+  AVIOContext *pb = create(path, interrupt);
+  if (pb) {
+    (*ctx)->pb = pb;
+    (*ctx)->flags |= AVFMT_FLAG_CUSTOM_IO;
+  }
+  int ret = avformat_open_input(ctx, path.toUtf8().constData(), nullptr, options);
+  // 失败时 avformat_open_input 已释放上下文，但不会释放自定义 I/O
+  if (ret < 0)
+    destroy(pb);
+  return ret;
+}
+
+void MediaIO::installHooks(AVFormatContext *fmtCtx) {
+  // 所有上下文的默认回调相同，记下第一次见到的即可
+  if (!s_defaultOpen) {
+    s_defaultOpen = fmtCtx->io_open;
+    s_defaultClose = fmtCtx->io_close;
+  }
+  fmtCtx->io_open = &MediaIO::openNested;
+  fmtCtx->io_close = &MediaIO::closeNested;
+}
+
+int MediaIO::openNested(AVFormatContext *s, AVIOContext **pb, const char *url,
+                        int flags, AVDictionary **options) {
+  if (!(flags & AVIO_FLAG_WRITE) && HttpCache::handles(QString::fromUtf8(url))) {
+    // 分片读取同样响应外层上下文的中断回调
+    *pb = HttpCache::create(QString::fromUtf8(url), false,
+                            &s->interrupt_callback);
+    if (*pb)
+      return 0;
+  }
+  return s_defaultOpen(s, pb, url, flags, options);
+}
+
+void MediaIO::closeNested(AVFormatContext *s, AVIOContext *pb) {
+  if (HttpCache::owns(pb))
+    HttpCache::destroy(pb);
+  else
+    s_defaultClose(s, pb);
+}
+
+bool MediaIO::open(const QString &path) {
+  m_fd = ::open(path.toUtf8().constData(), O_RDONLY | O_CLOEXEC);
+  if (m_fd < 0)
+    return false;
+  struct stat st;
+  if (fstat(m_fd, &st) < 0 || st.st_size <= 0)
+    return false;
+  m_size = st.st_size;
+  void *data = mmap(nullptr, size_t(m_size), PROT_READ, MAP_PRIVATE, m_fd, 0);
+  if (data == MAP_FAILED) {
+    qCDebug(lcPlayer) << "Media IO: mmap failed, using default file protocol";
+    return false;
+  }
+  m_data = static_cast<const uint8_t *>(data);
+  // 播放基本是顺序读，让内核读过的页尽早回收
+  madvise(data, size_t(m_size), MADV_SEQUENTIAL);
+
+  uint8_t *buffer = static_cast<uint8_t *>(av_malloc(IO_BUFFER_SIZE));
+  if (!buffer)
+    return false;
+  m_ctx = avio_alloc_context(buffer, IO_BUFFER_SIZE, 0, this,
+                             &MediaIO::readPacket, nullptr, &MediaIO::seek);
+  if (!m_ctx) {
+    av_free(buffer);
+    return false;
+  }
+  m_thread = std::thread(&MediaIO::readaheadLoop, this);
+  return true;
+}
+
+MediaIO::~MediaIO() {
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_stop = true;
+  }
+  m_cond.notify_all();
+  if (m_thread.joinable())
+    m_thread.join();
+  if (m_ctx) {
+    av_freep(&m_ctx->buffer);
+    av_freep(&m_ctx);
+  }
+  if (m_data)
+    munmap(const_cast<uint8_t *>(m_data), size_t(m_size));
+  if (m_fd >= 0)
+    ::close(m_fd);
+}
+
+int MediaIO::readPacket(void *opaque, uint8_t *buf, int size) {
+  MediaIO *io = static_cast<MediaIO *>(opaque);
+  if (io->m_pos >= io->m_size)
+    return AVERROR_EOF;
+  int len = int(std::min<qint64>(size, io->m_size - io->m_pos));
+  io->waitResident(io->m_pos, len);
+  memcpy(buf, io->m_data + io->m_pos, len);
+  io->m_pos += len;
+  return len;
+}
+
+int64_t MediaIO::seek(void *opaque, int64_t offset, int whence) {
+  MediaIO *io = static_cast<MediaIO *>(opaque);
+  if (whence & AVSEEK_SIZE)
+    return io->m_size;
+  switch (whence & ~AVSEEK_FORCE) {
+  case SEEK_SET:
+    break;
+  case SEEK_CUR:
+    offset += io->m_pos;
+    break;
+  case SEEK_END:
+    offset += io->m_size;
+    break;
+  default:
+    return AVERROR(EINVAL);
+  }
+  if (offset < 0)
+    return AVERROR(EINVAL);
+  io->m_pos = offset;
+  return offset;
+}
+
+void MediaIO::waitResident(qint64 pos, qint64 len) {
+  std::unique_lock<std::mutex> lk(m_mutex);
+  if (pos < m_residentStart || pos > m_residentEnd) {
+    // 跳到预读区间之外：窗口从新位置重新开始
+    m_residentStart = m_residentEnd = pos;
+    ++m_generation;
+  }
+  // 远在读位置之后的页已被顺序读策略回收，不再算作已读入
+  m_residentStart = std::max(m_residentStart, pos - s_readaheadBytes.load());
+  m_readPos = pos + len;
+  m_cond.notify_all();
+  m_cond.wait(lk, [&] { return m_stop || m_residentEnd >= pos + len; });
+}
+
+void MediaIO::fetch(qint64 begin, qint64 end) {
+  // 先让内核发起整块读取，再每页读一个字节，缺页在本线程内完成
+  const qint64 page = sysconf(_SC_PAGESIZE);
+  qint64 aligned = begin & ~(page - 1);
+  madvise(const_cast<uint8_t *>(m_data) + aligned, size_t(end - aligned),
+          MADV_WILLNEED);
+  volatile uint8_t sink = 0;
+  for (qint64 p = aligned; p < end; p += page)
+    sink += m_data[p];
+  (void)sink;
+  int latency = s_latencyMs;
+  if (latency > 0)
+    std::this_thread::sleep_for(std::chrono::milliseconds(latency));
+}
+
+void MediaIO::readaheadLoop() {
+  std::unique_lock<std::mutex> lk(m_mutex);
+  while (!m_stop) {
+    // 已读入的部分领先读位置不到一个窗口时继续读下一块
+    m_cond.wait(lk, [&] {
+      return m_stop || (m_residentEnd < m_size &&
+                        m_residentEnd < m_readPos + s_readaheadBytes);
+    });
+    if (m_stop)
+      break;
+    qint64 begin = m_residentEnd;
+    qint64 end = std::min(begin + CHUNK_BYTES, m_size);
+    quint64 generation = m_generation;
+    lk.unlock();
+    fetch(begin, end);
+    lk.lock();
+    // 读取期间发生了跳转则丢弃这一块
+    if (generation == m_generation) {
+      m_residentEnd = end;
+      m_cond.notify_all();
+    }
+  }
+}
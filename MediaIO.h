@@ -0,0 +1,73 @@
+#pragma once
+#include "FFmpegUtils.h"
+#include <QString>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// 输入的自定义 I/O
+// FFmpeg 默认的 file 协议每次同步 read 一小块，SD 卡延迟尖峰会直接变成掉帧。
+// 这里把整个文件 mmap 进来，读取只是内存拷贝；后台预读线程在读位置之前保持一个
+// 较大的窗口，提前触发缺页，把存储延迟挪到播放线程之外。
+// 还可以给每次从存储读取的块注入延迟，在开发机上模拟慢速存储测试缓冲效果。
+// http(s) 地址交给 HttpCache，经磁盘字节区间缓存读取。
+class MediaIO {
+public:
+  // 预读窗口大小与注入延迟（每个预读块），启动时由命令行设置
+  static void setReadaheadBytes(qint64 bytes);
+  static void setInjectedLatency(int ms);
+
+  // 为本地文件或网络地址创建 AVIOContext，不支持的输入或 mmap 失败时返回
+  // nullptr，调用方应回落到 FFmpeg 默认协议。与 AVFMT_FLAG_CUSTOM_IO 一起使用。
+  // interrupt 交给网络缓存，在等待下载时检查
+  static AVIOContext *create(const QString &path,
+                             const AVIOInterruptCB *interrupt = nullptr);
+  static void destroy(AVIOContext *pb);
+
+  // 以自定义 I/O 打开输入，用法同 avformat_open_input；解复用器自行打开的
+  // 输入（HLS 分片等）同样经过网络缓存。interrupt 用于中断阻塞的网络读取
+  static int openInput(AVFormatContext **ctx, const QString &path,
+                       AVDictionary **options,
+                       const AVIOInterruptCB *interrupt = nullptr);
+
+private:
+  static const int IO_BUFFER_SIZE = 64 * 1024;
+  static const qint64 CHUNK_BYTES = 256 * 1024; // 预读线程每次读取的块
+
+  MediaIO() = default;
+  ~MediaIO();
+  bool open(const QString &path);
+
+  static int readPacket(void *opaque, uint8_t *buf, int size);
+  static int64_t seek(void *opaque, int64_t offset, int whence);
+  static int openNested(AVFormatContext *s, AVIOContext **pb, const char *url,
+                        int flags, AVDictionary **options);
+  static void closeNested(AVFormatContext *s, AVIOContext *pb);
+  static void installHooks(AVFormatContext *fmtCtx);
+  void waitResident(qint64 pos, qint64 len);
+  void fetch(qint64 begin, qint64 end);
+  void readaheadLoop();
+
+  static std::atomic<qint64> s_readaheadBytes;
+  static std::atomic<int> s_latencyMs;
+  static int (*s_defaultOpen)(AVFormatContext *, AVIOContext **, const char *,
+                              int, AVDictionary **);
+  static void (*s_defaultClose)(AVFormatContext *, AVIOContext *);
+
+  int m_fd = -1;
+  const uint8_t *m_data = nullptr;
+  qint64 m_size = 0;
+  qint64 m_pos = 0; // 仅由解复用线程访问
+  AVIOContext *m_ctx = nullptr;
+
+  // 已读入的连续区间 [m_residentStart, m_residentEnd)；跳转到区间外时重新开始
+  std::thread m_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  bool m_stop = false;
+  qint64 m_readPos = 0;
+  qint64 m_residentStart = 0;
+  qint64 m_residentEnd = 0;
+  quint64 m_generation = 0; // 每次重新开始加一，丢弃跳转前发起的预读
+};
@@ -9,14 +9,62 @@ SOURCES += main.cpp \
            LyricManager.cpp \
            SubtitleManager.cpp \
            LyricRenderer.cpp \
-           SubtitleRenderer.cpp
+           SubtitleRenderer.cpp \
+           PacketBackBuffer.cpp \
+           LoopRegionCache.cpp \
+           FFmpegUtils.cpp \
+           GopCache.cpp \
+           MediaCache.cpp \
+           AudioSeekIndex.cpp \
+           DecodeQualityController.cpp \
+           FrameDecimator.cpp \
+           ProxyTranscoder.cpp \
+           ProbeCache.cpp \
+           MediaIO.cpp \
+           HttpCache.cpp \
+           VariantSelector.cpp \
+           PausePrefill.cpp \
+           FrameMailbox.cpp \
+           DecoderState.cpp \
+           OverlayLayer.cpp \
+           OverlayPainter.cpp \
+           OverlayCompositor.cpp \
+           TextCueCache.cpp \
+           AssLayer.cpp \
+           AssPrerenderer.cpp \
+           AssEngine.cpp \
+           PlayerLog.cpp
 
 HEADERS += VideoPlayer.h \
            FFMpegDecoder.h \
            LyricManager.h \
            SubtitleManager.h \
            LyricRenderer.h \
-           SubtitleRenderer.h
+           SubtitleRenderer.h \
+           PacketBackBuffer.h \
+           LoopRegionCache.h \
+           FFmpegUtils.h \
+           GopCache.h \
+           MediaCache.h \
+           AudioSeekIndex.h \
+           DecodeQualityController.h \
+           FrameDecimator.h \
+           ProxyTranscoder.h \
+           ProbeCache.h \
+           MediaIO.h \
+           HttpCache.h \
+           VariantSelector.h \
+           PausePrefill.h \
+           FrameMailbox.h \
+           DecoderState.h \
+           OverlayLayer.h \
+           OverlayPainter.h \
+           OverlayCompositor.h \
+           TextCueCache.h \
+           AssLayer.h \
+           AssPrerenderer.h \
+           AssEngine.h \
+           PlayerLog.h
 
 RESOURCES += resources.qrc
 
@@ -0,0 +1,106 @@
+#include "OverlayCompositor.h"
+
+OverlayCompositor::OverlayCompositor(FFMpegDecoder *decoder,
+                                     OverlayPainter *painter, QObject *parent)
+    : QObject(parent), m_decoder(decoder), m_painter(painter) {}
+
+OverlayCompositor::~OverlayCompositor() { stop(); }
+
+void OverlayCompositor::start() {
+  stop();
+  m_quit = false;
+  m_pending = false;
+  m_damage = QRegion();
+  m_thread = std::thread(&OverlayCompositor::run, this);
+}
+
+void OverlayCompositor::stop() {
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_quit = true;
+  }
+  m_cond.notify_one();
+  if (m_thread.joinable())
+    m_thread.join();
+}
+
+void OverlayCompositor::submit(const OverlayScene &scene,
+                               const QRegion &damage) {
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_scene = scene;
+    m_damage += damage;
+    m_pending = true;
+  }
+  m_cond.notify_one();
+}
+
+std::shared_ptr<const QImage> OverlayCompositor::result() {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  return m_front;
+}
+
+void OverlayCompositor::run() {
+  std::unique_lock<std::mutex> lk(m_mutex);
+  while (true) {
+    m_cond.wait(lk, [this] { return m_quit || m_pending; });
+    if (m_quit)
+      break;
+    OverlayScene scene = m_scene;
+    QRegion damage = m_damage;
+    m_damage = QRegion();
+    m_pending = false;
+    lk.unlock();
+    compose(scene, damage);
+    lk.lock();
+  }
+}
+
+void OverlayCompositor::compose(const OverlayScene &scene,
+                                const QRegion &damage) {
+  // 界面直接收到的整帧图像，以及信箱中更新的解码帧
+  if (scene.frameSerial != m_frameSerial) {
+    m_frameSerial = scene.frameSerial;
+    m_frame = scene.frame;
+  }
+  if (std::unique_ptr<FrameMailbox::Frame> f = m_decoder->takeFrame()) {
+    QSharedPointer<QImage> img =
+        m_converter.convert(f->frame.get(), f->width, f->height, f->swsFlags);
+    if (img)
+      m_frame = img;
+  }
+  if (scene.size.isEmpty())
+    return;
+
+  // 取一张界面没有在用的缓冲区：界面只从 m_front 拿引用，
+  // 所以 m_back 引用计数为 1 时可以直接改写
+  std::shared_ptr<QImage> out;
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    out = std::move(m_back);
+  }
+  if (!out || out.use_count() != 1 || out->size() != scene.size)
+    out = std::make_shared<QImage>(scene.size, QImage::Format_RGB32);
+  if (out->isNull())
+    return;
+
+  QRect frameRect;
+  if (m_frame && !m_frame->isNull())
+    frameRect = OverlayPainter::fitRect(m_frame->size(), scene.size);
+  QRect full(QPoint(0, 0), scene.size);
+  {
+    QPainter p(out.get());
+    for (const QRect &r : QRegion(full).subtracted(QRegion(frameRect)))
+      p.fillRect(r, Qt::black);
+    if (!frameRect.isEmpty())
+      p.drawImage(frameRect, *m_frame);
+    m_painter->paint(p, scene, QRegion(full));
+  }
+
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_back = std::move(m_front);
+    m_front = std::move(out);
+  }
+  emit composed(frameRect, damage);
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <QObject>
+#include <QRect>
+#include <QRegion>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "FFMpegDecoder.h"
+#include "OverlayPainter.h"
+
+// 叠加层合成线程（可选，--compositor 开启）
+// 界面在每个刷新时刻提交一份叠加层状态，合成线程从帧信箱取最新的解码帧做颜色
+// 转换，连同字幕、歌词、土司消息和进度条一起画进一张与窗口同尺寸的图像，完成后
+// 连同这张图像覆盖的更新区域通知界面。界面线程只把这些区域贴到窗口上。被替换
+// 的状态的更新区域并入下一次合成，不会丢失。输出图像双缓冲：
+// 界面正在贴的那张不会被合成线程改写。
+class OverlayCompositor : public QObject {
+  Q_OBJECT
+public:
+  OverlayCompositor(FFMpegDecoder *decoder, OverlayPainter *painter,
+                    QObject *parent = nullptr);
+  ~OverlayCompositor();
+
+  void start();
+  void stop();
+
+  // 提交一份叠加层状态和它要更新的区域；还没开始合成的旧状态被替换，区域合并
+  void submit(const OverlayScene &scene, const QRegion &damage);
+
+  // 最近合成完成的图像，还没有时为空
+  std::shared_ptr<const QImage> result();
+
+signals:
+  // 一张图像合成完成；frameRect 为其中视频帧的位置，damage 为这张图像包含的
+  // 全部已提交更新
+  void composed(const QRect &frameRect, const QRegion &damage);
+
+private:
+  void run();
+  void compose(const OverlayScene &scene, const QRegion &damage);
+
+  FFMpegDecoder *m_decoder;
+  OverlayPainter *m_painter;
+
+  std::thread m_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  bool m_quit = false;
+  bool m_pending = false;
+  OverlayScene m_scene;
+  QRegion m_damage; // 已提交、还没开始合成的更新区域
+  std::shared_ptr<QImage> m_front; // 界面读取的图像
+  std::shared_ptr<QImage> m_back;  // 合成线程写入的图像
+
+  // 以下只在合成线程访问
+  FrameConverter m_converter;
+  QSharedPointer<QImage> m_frame;
+  quint64 m_frameSerial = 0;
+};
@@ -0,0 +1,19 @@
+#include "OverlayLayer.h"
+
+void OverlayLayer::render(const QString &key, const QSize &size,
+                          const std::function<void(QPainter &)> &paint) {
+  m_key = key;
+  if (m_image.size() != size)
+    m_image = QImage(size, QImage::Format_ARGB32_Premultiplied);
+  if (m_image.isNull())
+    return;
+  m_image.fill(Qt::transparent);
+  QPainter p(&m_image);
+  p.setRenderHint(QPainter::Antialiasing, true);
+  paint(p);
+}
+
+void OverlayLayer::clear() {
+  m_key.clear();
+  m_image = QImage();
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <QImage>
+#include <QPainter>
+#include <QString>
+#include <functional>
+
+// 预渲染的叠加层
+// 土司消息、错误框、进度条的内容很少变化，动画只改变透明度和位置。每个叠加层
+// 渲染一次到预乘 alpha 的图像里，内容键变化时才重画；绘制时按透明度和偏移贴图，
+// 不再每次绘制都重新测量文字、画抗锯齿圆角矩形。
+class OverlayLayer {
+public:
+  // 缓存的内容是否对应 key
+  bool matches(const QString &key) const {
+    return !m_image.isNull() && m_key == key;
+  }
+
+  // 按 size 重建透明图像，用 paint 渲染内容（画笔已开启抗锯齿）
+  void render(const QString &key, const QSize &size,
+              const std::function<void(QPainter &)> &paint);
+
+  const QImage &image() const { return m_image; }
+  void clear();
+
+private:
+  QString m_key;
+  QImage m_image;
+};
@@ -0,0 +1,219 @@
+#include "OverlayPainter.h"
+#include <QFontMetrics>
+
+OverlayPainter::OverlayPainter(SubtitleManager *subtitles,
+                               SubtitleRenderer *subtitleRenderer,
+                               LyricRenderer *lyricRenderer)
+    : m_subtitles(subtitles), m_subtitleRenderer(subtitleRenderer),
+      m_lyricRenderer(lyricRenderer) {}
+
+QFont OverlayPainter::font(int pointSize) {
+  QFont font("Microsoft YaHei", 0, QFont::Bold);
+  font.setPointSize(pointSize);
+  return font;
+}
+
+QRect OverlayPainter::fitRect(const QSize &image, const QSize &area) {
+  if (image.isEmpty())
+    return QRect();
+  QSize imgSize = image;
+  imgSize.scale(area, Qt::KeepAspectRatio);
+  QRect targetRect(QPoint(0, 0), imgSize);
+  targetRect.moveCenter(QRect(QPoint(0, 0), area).center());
+  return targetRect;
+}
+
+QRect OverlayPainter::subtitleBand(const QSize &area, bool ass) {
+  QRect full(QPoint(0, 0), area);
+  // ASS 字幕可以出现在画面任意位置
+  if (ass)
+    return full;
+  // 字幕居中在底部 60px 的区域里，多行时会向上超出，留出余量
+  return full.adjusted(0, area.height() - 120, 0, 0);
+}
+
+void OverlayPainter::paint(QPainter &p, const OverlayScene &scene,
+                           const QRegion &dirty) {
+  // 绘制字幕和歌词
+  if (dirty.intersects(subtitleBand(scene.size, m_subtitles->hasAss())))
+    drawSubtitles(p, scene);
+
+  // 绘制顶部土司消息
+  drawToast(p, scene, dirty);
+  drawManualToast(p, scene, dirty);
+
+  // 绘制错误消息
+  drawError(p, scene, dirty);
+
+  if (scene.progress)
+    drawProgressBar(p, scene, dirty);
+}
+
+void OverlayPainter::drawSubtitles(QPainter &p, const OverlayScene &scene) {
+  // 更新字幕索引
+  m_subtitles->updateSubtitleIndex(scene.pts);
+
+  QRect lyricRect(0, scene.size.height() - 70, scene.size.width(), 60);
+  if (scene.subtitles) {
+    m_subtitleRenderer->drawSrtSubtitles(p, lyricRect, scene.fontSize,
+                                         scene.pts);
+    m_lyricRenderer->drawLyricsByTime(p, lyricRect, scene.fontSize, scene.pts);
+  }
+  // libass 在后台初始化，完成前不显示 ASS 字幕
+  ASS_Renderer *assRenderer = m_assEngine ? m_assEngine->renderer() : nullptr;
+  if (m_subtitles->hasAss() && m_subtitles->getAssTrack() && assRenderer) {
+    m_subtitleRenderer->setAssRenderer(assRenderer);
+    m_subtitleRenderer->drawAssSubtitles(p, scene.size.width(),
+                                         scene.size.height(), scene.pts);
+  }
+}
+
+void OverlayPainter::drawToast(QPainter &p, const OverlayScene &scene,
+                               const QRegion &dirty) {
+  if (scene.toast.isEmpty())
+    return;
+
+  // 消息只渲染一次，动画只改变贴图的透明度和位置
+  if (!m_toastLayer.matches(scene.toast)) {
+    QFont toastFont = font(scene.fontSize + 2);
+    QFontMetrics fm(toastFont);
+    QSize toastSize(fm.horizontalAdvance(scene.toast) + 40, fm.height() + 16);
+    m_toastLayer.render(scene.toast, toastSize, [&](QPainter &lp) {
+      QRect toastRect(QPoint(0, 0), toastSize);
+      lp.setPen(Qt::NoPen);
+      lp.setBrush(QColor(0, 0, 0, 200));
+      lp.drawRoundedRect(toastRect, 12, 12);
+      lp.setFont(toastFont);
+      lp.setPen(Qt::white);
+      lp.drawText(toastRect, Qt::AlignCenter, scene.toast);
+    });
+  }
+
+  const QImage &toast = m_toastLayer.image();
+  QRect toastRect((scene.size.width() - toast.width()) / 2,
+                  20 + scene.toastOffset, toast.width(), toast.height());
+  if (!dirty.intersects(toastRect))
+    return;
+  p.save();
+  p.setOpacity(scene.toastOpacity);
+  p.drawImage(toastRect.topLeft(), toast);
+  p.restore();
+}
+
+void OverlayPainter::drawManualToast(QPainter &p, const OverlayScene &scene,
+                                     const QRegion &dirty) {
+  if (scene.manualToast.isEmpty())
+    return;
+
+  if (!m_manualToastLayer.matches(scene.manualToast)) {
+    QFont manualFont = font(scene.fontSize);
+    QFontMetrics fm(manualFont);
+    QSize toastSize(fm.horizontalAdvance(scene.manualToast) + 20,
+                    fm.height() + 8);
+    m_manualToastLayer.render(
+        scene.manualToast, toastSize, [&](QPainter &lp) {
+          QRect toastRect(QPoint(0, 0), toastSize);
+          lp.setPen(Qt::NoPen);
+          lp.setBrush(QColor(20, 20, 20, 220));
+          lp.drawRoundedRect(toastRect, 12, 12);
+          lp.setFont(manualFont);
+          lp.setPen(Qt::white);
+          lp.drawText(toastRect, Qt::AlignCenter, scene.manualToast);
+        });
+  }
+
+  // 居中显示，文字宽度为贴图宽度减去左右边距
+  const QImage &toast = m_manualToastLayer.image();
+  int textWidth = toast.width() - 20;
+  int textHeight = toast.height() - 8;
+  QRect toastRect((scene.size.width() - textWidth) / 2 - 20,
+                  scene.size.height() / 2 - textHeight / 2, toast.width(),
+                  toast.height());
+  if (!dirty.intersects(toastRect))
+    return;
+  p.save();
+  p.setOpacity(scene.manualToastOpacity); // 支持透明度动画
+  p.drawImage(toastRect.topLeft(), toast);
+  p.restore();
+}
+
+void OverlayPainter::drawError(QPainter &p, const OverlayScene &scene,
+                               const QRegion &dirty) {
+  if (scene.error.isEmpty())
+    return;
+
+  // 消息变化时才重新渲染消息框
+  if (!m_errorLayer.matches(scene.error)) {
+    QFont errFont = font(scene.fontSize + 4);
+    QFontMetrics fm(errFont);
+    QSize boxSize(fm.horizontalAdvance(scene.error) + 60, fm.height() + 32);
+    m_errorLayer.render(scene.error, boxSize, [&](QPainter &lp) {
+      QRect boxRect(QPoint(0, 0), boxSize);
+      lp.setPen(Qt::NoPen);
+      lp.setBrush(QColor(0, 0, 0, 180));
+      lp.drawRoundedRect(boxRect, 18, 18);
+      lp.setFont(errFont);
+      lp.setPen(QColor(220, 40, 40));
+      lp.drawText(boxRect, Qt::AlignCenter, scene.error);
+    });
+  }
+
+  const QImage &box = m_errorLayer.image();
+  QRect boxRect((scene.size.width() - box.width()) / 2,
+                (scene.size.height() - box.height()) / 2, box.width(),
+                box.height());
+  if (dirty.intersects(boxRect))
+    p.drawImage(boxRect.topLeft(), box);
+}
+
+void OverlayPainter::drawProgressBar(QPainter &p, const OverlayScene &scene,
+                                     const QRegion &dirty) {
+  // 样式参数
+  const int barHeight = 4;
+  const int radius = 2; // 圆角半径
+  const int marginX = 0;
+  const int barWidth = scene.size.width() - marginX * 2;
+  const int barY = scene.size.height() - barHeight;
+  if (barWidth <= 0 ||
+      !dirty.intersects(QRect(marginX, barY, barWidth, barHeight)))
+    return;
+
+  // 按像素取整：进度每前进一个像素才重新渲染一次
+  qint64 duration = scene.duration;
+  int playedPx = duration > 0 ? int(barWidth * scene.pts / duration) : 0;
+  int loopX = -1, loopW = 0;
+  if (duration > 0 && scene.loopStartMs >= 0) {
+    qint64 endMs = scene.loopEndMs >= 0 ? scene.loopEndMs : scene.loopStartMs;
+    loopX = int(barWidth * scene.loopStartMs / duration);
+    loopW = qMax(2, int(barWidth * (endMs - scene.loopStartMs) / duration));
+  }
+  QString key = QString("%1:%2:%3:%4")
+                    .arg(barWidth)
+                    .arg(playedPx)
+                    .arg(loopX)
+                    .arg(loopW);
+
+  if (!m_progressLayer.matches(key)) {
+    m_progressLayer.render(key, QSize(barWidth, barHeight), [&](QPainter &lp) {
+      QRectF fullBar(0, 0, barWidth, barHeight);
+
+      // 背景轨道（浅灰色）
+      lp.setBrush(QColor(80, 80, 80, 180)); // 半透明深灰
+      lp.setPen(Qt::NoPen);
+      lp.drawRoundedRect(fullBar, radius, radius);
+
+      // 播放进度（红色）
+      if (playedPx > 0) {
+        lp.setBrush(QColor(255, 60, 60)); // 柔和红色
+        lp.drawRoundedRect(QRectF(0, 0, playedPx, barHeight), radius, radius);
+      }
+
+      // A-B 循环区间（半透明黄色）
+      if (loopX >= 0) {
+        lp.setBrush(QColor(255, 210, 60, 200));
+        lp.drawRoundedRect(QRectF(loopX, 0, loopW, barHeight), radius, radius);
+      }
+    });
+  }
+  p.drawImage(marginX, barY, m_progressLayer.image());
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <QFont>
+#include <QImage>
+#include <QPainter>
+#include <QRegion>
+#include <QSharedPointer>
+#include <QString>
+#include <ass/ass.h>
+
+#include "AssEngine.h"
+#include "LyricRenderer.h"
+#include "OverlayLayer.h"
+#include "SubtitleRenderer.h"
+
+// 一次绘制所需的叠加层状态
+// 由界面线程填写；合成线程拿到的是一份拷贝，不再访问界面的成员。
+struct OverlayScene {
+  QSize size;                   // 画面尺寸
+  QSharedPointer<QImage> frame; // 界面线程直接收到的整帧图像
+  quint64 frameSerial = 0;      // frame 每换一次加一
+  qint64 pts = 0;
+  int fontSize = 10;
+
+  bool subtitles = true; // 字幕、歌词开关（ASS 字幕不受它控制）
+
+  QString toast;
+  qreal toastOpacity = 0.0;
+  int toastOffset = 0; // 顶部土司消息的滑动偏移
+
+  QString manualToast;
+  qreal manualToastOpacity = 0.0;
+
+  QString error;
+
+  bool progress = false; // 是否显示进度条
+  qint64 duration = 0;
+  qint64 loopStartMs = -1;
+  qint64 loopEndMs = -1;
+};
+
+// 在视频帧之上绘制字幕、歌词、土司消息、错误框和进度条
+// 界面线程直接绘制和合成线程共用这份代码；同一时间只能有一个线程使用，
+// 字幕渲染器和 libass 渲染器都不是线程安全的。
+class OverlayPainter {
+public:
+  OverlayPainter(SubtitleManager *subtitles, SubtitleRenderer *subtitleRenderer,
+                 LyricRenderer *lyricRenderer);
+  void setAssEngine(AssEngine *engine) { m_assEngine = engine; }
+
+  // 绘制叠加层，与 dirty 不相交的部分跳过
+  void paint(QPainter &p, const OverlayScene &scene, const QRegion &dirty);
+
+  static QFont font(int pointSize); // 叠加层粗体字体
+  // 视频帧按比例缩放后在画面中居中的位置
+  static QRect fitRect(const QSize &image, const QSize &area);
+  // 字幕、歌词可能绘制的区域
+  static QRect subtitleBand(const QSize &area, bool ass);
+
+private:
+  void drawSubtitles(QPainter &p, const OverlayScene &scene);
+  void drawToast(QPainter &p, const OverlayScene &scene, const QRegion &dirty);
+  void drawManualToast(QPainter &p, const OverlayScene &scene,
+                       const QRegion &dirty);
+  void drawError(QPainter &p, const OverlayScene &scene, const QRegion &dirty);
+  void drawProgressBar(QPainter &p, const OverlayScene &scene,
+                       const QRegion &dirty);
+
+  SubtitleManager *m_subtitles;
+  SubtitleRenderer *m_subtitleRenderer;
+  LyricRenderer *m_lyricRenderer;
+  AssEngine *m_assEngine = nullptr;
+
+  // 预渲染的叠加层，内容变化时才重画
+  OverlayLayer m_toastLayer;
+  OverlayLayer m_manualToastLayer;
+  OverlayLayer m_errorLayer;
+  OverlayLayer m_progressLayer;
+};
@@ -0,0 +1,108 @@
+#include "PacketBackBuffer.h"
+
+namespace {
+size_t packet_cost(const AVPacket *pkt) {
+  return sizeof(AVPacket) + (pkt->size > 0 ? size_t(pkt->size) : 0);
+}
+} // namespace
+
+PacketBackBuffer::PacketBackBuffer(size_t maxBytes) : m_maxBytes(maxBytes) {}
+
+PacketBackBuffer::~PacketBackBuffer() { clear(); }
+
+void PacketBackBuffer::reset(AVRational timeBase) {
+  clear();
+  m_timeBase = timeBase;
+}
+
+void PacketBackBuffer::clear() {
+  while (!m_entries.empty())
+    popFront();
+  m_bytes = 0;
+  m_cursor = 0;
+  m_replaying = false;
+}
+
+void PacketBackBuffer::push(const AVPacket *pkt) {
+  bool key = (pkt->flags & AV_PKT_FLAG_KEY) != 0;
+  // 缓冲区必须从关键帧开始，否则重放出来的数据无法解码
+  if (m_entries.empty() && !key)
+    return;
+
+  int64_t ts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+  if (ts == AV_NOPTS_VALUE) {
+    // 没有时间戳的包无法参与定位，丢弃整个窗口重新开始
+    clear();
+    return;
+  }
+
+  AVPacket *copy = av_packet_clone(pkt);
+  if (!copy)
+    return;
+
+  m_entries.push_back({copy, av_rescale_q(ts, m_timeBase, {1, 1000}), key});
+  m_bytes += packet_cost(copy);
+  evict();
+}
+
+bool PacketBackBuffer::seek(int64_t ms) {
+  if (m_entries.empty() || ms < m_entries.front().ms ||
+      ms > m_entries.back().ms)
+    return false;
+
+  // 找到目标之前最近的关键帧
+  size_t keyIdx = 0;
+  for (size_t i = 0; i < m_entries.size(); ++i) {
+    if (m_entries[i].key && m_entries[i].ms <= ms)
+      keyIdx = i;
+  }
+  m_cursor = keyIdx;
+  m_replaying = true;
+  return true;
+}
+
+bool PacketBackBuffer::next(AVPacket *out) {
+  if (!m_replaying)
+    return false;
+  if (m_cursor >= m_entries.size()) {
+    m_replaying = false;
+    return false;
+  }
+  if (av_packet_ref(out, m_entries[m_cursor].pkt) < 0) {
+    m_replaying = false;
+    return false;
+  }
+  ++m_cursor;
+  return true;
+}
+
+int64_t PacketBackBuffer::startMs() const {
+  return m_entries.empty() ? 0 : m_entries.front().ms;
+}
+
+int64_t PacketBackBuffer::endMs() const {
+  return m_entries.empty() ? 0 : m_entries.back().ms;
+}
+
+void PacketBackBuffer::popFront() {
+  Entry &e = m_entries.front();
+  m_bytes -= packet_cost(e.pkt);
+  av_packet_free(&e.pkt);
+  m_entries.pop_front();
+}
+
+void PacketBackBuffer::evict() {
+  // 整 GOP 淘汰，保证剩余数据仍从关键帧开始
+  while (m_bytes > m_maxBytes && !m_entries.empty()) {
+    size_t nextKey = 1;
+    while (nextKey < m_entries.size() && !m_entries[nextKey].key)
+      ++nextKey;
+    if (nextKey >= m_entries.size()) {
+      // 单个 GOP 已超出上限，无法对齐保存
+      clear();
+      return;
+    }
+    for (size_t i = 0; i < nextKey; ++i)
+      popFront();
+  }
+}
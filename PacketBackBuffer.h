@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+// 已解复用数据包的回退缓冲区（单个流）
+// 按读取顺序保存最近的数据包，起点始终对齐到关键帧（GOP 边界），
+// 超出内存上限时整 GOP 淘汰。向后短距离跳转落在窗口内时直接从内存重放，
+// 重放结束后继续从文件当前读取位置往下读，两者天然衔接。
+class PacketBackBuffer {
+public:
+  explicit PacketBackBuffer(size_t maxBytes);
+  ~PacketBackBuffer();
+
+  // 清空并设置所属流的时间基（切换轨道或重新打开文件时调用）
+  void reset(AVRational timeBase);
+  void clear();
+
+  // 记录一个从文件读出的数据包，重放出来的包不要再次写入
+  void push(const AVPacket *pkt);
+
+  // 目标时间在窗口内时定位到其之前最近的关键帧并进入重放，返回 true
+  bool seek(int64_t ms);
+
+  // 取出下一个重放包（引用计数拷贝到 out），不在重放或已重放完返回 false
+  bool next(AVPacket *out);
+
+  bool replaying() const { return m_replaying; }
+  size_t bytes() const { return m_bytes; }
+  int64_t startMs() const;
+  int64_t endMs() const;
+
+private:
+  struct Entry {
+    AVPacket *pkt;
+    int64_t ms;
+    bool key;
+  };
+
+  void popFront();
+  void evict();
+
+  std::deque<Entry> m_entries;
+  size_t m_bytes = 0;
+  size_t m_maxBytes;
+  size_t m_cursor = 0;
+  bool m_replaying = false;
+  AVRational m_timeBase = {1, 1000};
+};
@@ -0,0 +1,64 @@
+#include "PausePrefill.h"
+
+namespace {
+size_t frame_cost(const AVFrame *frame) {
+  size_t bytes = sizeof(AVFrame);
+  for (int i = 0; i < AV_NUM_DATA_POINTERS && frame->buf[i]; i++)
+    bytes += frame->buf[i]->size;
+  return bytes;
+}
+
+// 复制到新分配的缓冲区；不能分配普通缓冲区的帧（硬件帧）退回引用
+AVFrame *copy_frame(const AVFrame *src) {
+  AVFrame *dst = av_frame_alloc();
+  if (!dst)
+    return nullptr;
+  dst->format = src->format;
+  dst->width = src->width;
+  dst->height = src->height;
+  dst->nb_samples = src->nb_samples;
+  dst->channels = src->channels;
+  dst->channel_layout = src->channel_layout;
+  if (av_frame_get_buffer(dst, 0) < 0 || av_frame_copy(dst, src) < 0 ||
+      av_frame_copy_props(dst, src) < 0) {
+    av_frame_unref(dst);
+    if (av_frame_ref(dst, src) < 0)
+      av_frame_free(&dst);
+  }
+  return dst;
+}
+} // namespace
+
+PausePrefill::PausePrefill(size_t maxBytes) : m_maxBytes(maxBytes) {}
+
+PausePrefill::~PausePrefill() { clear(); }
+
+void PausePrefill::clear() {
+  for (Entry &e : m_entries)
+    av_frame_free(&e.frame);
+  m_entries.clear();
+  m_bytes = 0;
+}
+
+void PausePrefill::push(const AVFrame *frame, int64_t tag) {
+  AVFrame *copy = copy_frame(frame);
+  if (!copy)
+    return;
+  size_t bytes = frame_cost(copy);
+  m_entries.push_back({copy, tag, bytes});
+  m_bytes += bytes;
+}
+
+bool PausePrefill::pop(AVFrame *out, int64_t *tag) {
+  if (m_entries.empty())
+    return false;
+  Entry e = m_entries.front();
+  m_entries.pop_front();
+  m_bytes -= e.bytes;
+  av_frame_unref(out);
+  av_frame_move_ref(out, e.frame);
+  av_frame_free(&e.frame);
+  if (tag)
+    *tag = e.tag;
+  return true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+// 暂停期间预先解码的帧（单个流）
+// 暂停时解码线程不再空等，继续读包解码，把解码出的帧存到这里直到内存上限再睡眠；
+// 恢复播放时先从这里取帧，走与解码器输出相同的后续流程，第一帧不必等待解码。
+// 存的是帧数据的拷贝而不是引用，避免长时间占住解码器（尤其是硬件解码器）
+// 数量有限的缓冲池。
+class PausePrefill {
+public:
+  explicit PausePrefill(size_t maxBytes);
+  ~PausePrefill();
+
+  void clear(); // 跳转、切换轨道后预取的帧作废
+
+  // 保存一帧的拷贝；tag 随帧保存，供调用方记录帧的附加位置信息
+  void push(const AVFrame *frame, int64_t tag = -1);
+
+  // 按解码顺序取出最早的一帧，没有时返回 false
+  bool pop(AVFrame *out, int64_t *tag = nullptr);
+
+  bool empty() const { return m_entries.empty(); }
+  bool full() const { return m_bytes >= m_maxBytes; }
+  size_t size() const { return m_entries.size(); }
+
+private:
+  struct Entry {
+    AVFrame *frame;
+    int64_t tag;
+    size_t bytes;
+  };
+
+  std::deque<Entry> m_entries;
+  size_t m_bytes = 0;
+  size_t m_maxBytes;
+};
@@ -0,0 +1,4 @@
+#include "PlayerLog.h"
+
+// 只默认输出 info 及以上级别，qCDebug 在打开之前几乎没有开销
+Q_LOGGING_CATEGORY(lcPlayer, "newplayer", QtInfoMsg)
@@ -0,0 +1,6 @@
+#pragma once
+#include <QLoggingCategory>
+
+// 逐事件的调试输出（seek、缓存命中、下载进度等）
+// 默认关闭，需要时用环境变量打开：QT_LOGGING_RULES="newplayer.debug=true"
+Q_DECLARE_LOGGING_CATEGORY(lcPlayer)
@@ -0,0 +1,292 @@
+#include "ProbeCache.h"
+#include "MediaCache.h"
+#include "PlayerLog.h"
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSaveFile>
+#include <QtDebug>
+#include <cstring>
+
+namespace {
+const quint32 PROBE_MAGIC = 0x50524F42; // "PROB"
+const quint32 PROBE_VERSION = 1;
+const int MAX_STREAMS = 64;
+
+QDataStream &operator<<(QDataStream &out, const AVRational &r) {
+  return out << qint32(r.num) << qint32(r.den);
+}
+
+QDataStream &operator>>(QDataStream &in, AVRational &r) {
+  qint32 num = 0, den = 0;
+  in >> num >> den;
+  r = {num, den};
+  return in;
+}
+
+bool sameRational(AVRational a, AVRational b) {
+  return a.num == b.num && a.den == b.den;
+}
+} // namespace
+
+ProbeCache::~ProbeCache() { stop(); }
+
+void ProbeCache::reset(const QString &path) {
+  stop();
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_path = path;
+  m_loaded = false;
+  m_valid = false;
+  m_warm = false;
+  m_streams.clear();
+}
+
+bool ProbeCache::warm() const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  return m_warm;
+}
+
+void ProbeCache::probeInBackground(
+    const std::function<void(const AVFormatContext *)> &probed) {
+  // 检查和启动在同一把锁内，两个调用方不会同时启动线程
+  std::lock_guard<std::mutex> lk(m_mutex);
+  if (m_valid || m_path.isEmpty() || m_thread.joinable())
+    return;
+  m_stop = false;
+  m_thread = std::thread(&ProbeCache::run, this, m_path, probed);
+}
+
+void ProbeCache::stop() {
+  // 在锁内取走线程，锁外等待：后台线程写缓存时也要加这把锁
+  std::thread thread;
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_stop = true;
+    thread = std::move(m_thread);
+  }
+  if (thread.joinable())
+    thread.join();
+}
+
+void ProbeCache::run(QString path,
+                     std::function<void(const AVFormatContext *)> probed) {
+  MediaCache::setBackgroundPriority();
+  QElapsedTimer timer;
+  timer.start();
+  AVFormatContext *raw_fmt_ctx = nullptr;
+  if (avformat_open_input(&raw_fmt_ctx, path.toUtf8().constData(), nullptr,
+                          nullptr) < 0)
+    return;
+  AVFormatContextPtr fmtCtx(raw_fmt_ctx);
+  set_probe_limits(fmtCtx.get());
+  if (m_stop || avformat_find_stream_info(fmtCtx.get(), nullptr) < 0)
+    return;
+  store(fmtCtx.get());
+  qCDebug(lcPlayer) << "Probe cache: probed all" << fmtCtx->nb_streams
+                    << "streams in background in" << timer.elapsed() << "ms";
+  if (probed && !m_stop)
+    probed(fmtCtx.get());
+}
+
+bool ProbeCache::cacheable(const AVFormatContext *fmtCtx) {
+  // 没有文件头的格式（MPEG-TS、裸流等）要读数据才能发现流，无法跳过探测
+  return !(fmtCtx->ctx_flags & AVFMTCTX_NOHEADER) && fmtCtx->nb_streams > 0 &&
+         fmtCtx->nb_streams <= unsigned(MAX_STREAMS);
+}
+
+bool ProbeCache::apply(AVFormatContext *fmtCtx) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  if (!m_loaded) {
+    m_loaded = true;
+    m_valid = m_warm = load();
+  }
+  if (!m_valid || !cacheable(fmtCtx) ||
+      fmtCtx->nb_streams != unsigned(m_streams.size()))
+    return false;
+
+  // 文件头解析出的流必须与缓存一致，否则说明缓存不可信
+  for (unsigned i = 0; i < fmtCtx->nb_streams; i++) {
+    const AVStream *st = fmtCtx->streams[i];
+    const StreamInfo &info = m_streams[i];
+    if (st->codecpar->codec_type != info.codecType ||
+        st->codecpar->codec_id != info.codecId ||
+        !sameRational(st->time_base, info.timeBase)) {
+      qCDebug(lcPlayer) << "Probe cache: stream" << i << "mismatch, probing";
+      return false;
+    }
+  }
+
+  for (unsigned i = 0; i < fmtCtx->nb_streams; i++) {
+    AVStream *st = fmtCtx->streams[i];
+    AVCodecParameters *par = st->codecpar;
+    const StreamInfo &info = m_streams[i];
+    par->codec_tag = info.codecTag;
+    if (!info.extradata.isEmpty()) {
+      uint8_t *extradata = static_cast<uint8_t *>(
+          av_mallocz(info.extradata.size() + AV_INPUT_BUFFER_PADDING_SIZE));
+      if (!extradata)
+        return false;
+      memcpy(extradata, info.extradata.constData(), info.extradata.size());
+      av_freep(&par->extradata);
+      par->extradata = extradata;
+      par->extradata_size = info.extradata.size();
+    }
+    par->format = info.format;
+    par->bit_rate = info.bitRate;
+    par->bits_per_coded_sample = info.bitsPerCodedSample;
+    par->bits_per_raw_sample = info.bitsPerRawSample;
+    par->profile = info.profile;
+    par->level = info.level;
+    par->width = info.width;
+    par->height = info.height;
+    par->sample_aspect_ratio = info.sampleAspectRatio;
+    par->field_order = AVFieldOrder(info.fieldOrder);
+    par->color_range = AVColorRange(info.colorRange);
+    par->color_primaries = AVColorPrimaries(info.colorPrimaries);
+    par->color_trc = AVColorTransferCharacteristic(info.colorTrc);
+    par->color_space = AVColorSpace(info.colorSpace);
+    par->chroma_location = AVChromaLocation(info.chromaLocation);
+    par->video_delay = info.videoDelay;
+    par->channel_layout = info.channelLayout;
+    par->channels = info.channels;
+    par->sample_rate = info.sampleRate;
+    par->block_align = info.blockAlign;
+    par->frame_size = info.frameSize;
+    par->initial_padding = info.initialPadding;
+    par->trailing_padding = info.trailingPadding;
+    par->seek_preroll = info.seekPreroll;
+    st->avg_frame_rate = info.avgFrameRate;
+    st->r_frame_rate = info.rFrameRate;
+    st->start_time = info.startTime;
+    st->duration = info.duration;
+    if (!info.language.isEmpty() &&
+        !av_dict_get(st->metadata, "language", nullptr, 0))
+      av_dict_set(&st->metadata, "language", info.language.toUtf8().constData(),
+                  0);
+  }
+  fmtCtx->duration = m_duration;
+  fmtCtx->start_time = m_startTime;
+  fmtCtx->bit_rate = m_bitRate;
+  return true;
+}
+
+void ProbeCache::store(AVFormatContext *fmtCtx) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  if (!cacheable(fmtCtx))
+    return;
+  std::vector<StreamInfo> streams;
+  for (unsigned i = 0; i < fmtCtx->nb_streams; i++) {
+    const AVStream *st = fmtCtx->streams[i];
+    const AVCodecParameters *par = st->codecpar;
+    StreamInfo info;
+    info.codecType = par->codec_type;
+    info.codecId = par->codec_id;
+    info.codecTag = par->codec_tag;
+    if (par->extradata && par->extradata_size > 0)
+      info.extradata = QByteArray(reinterpret_cast<const char *>(par->extradata),
+                                  par->extradata_size);
+    info.format = par->format;
+    info.bitRate = par->bit_rate;
+    info.bitsPerCodedSample = par->bits_per_coded_sample;
+    info.bitsPerRawSample = par->bits_per_raw_sample;
+    info.profile = par->profile;
+    info.level = par->level;
+    info.width = par->width;
+    info.height = par->height;
+    info.sampleAspectRatio = par->sample_aspect_ratio;
+    info.fieldOrder = par->field_order;
+    info.colorRange = par->color_range;
+    info.colorPrimaries = par->color_primaries;
+    info.colorTrc = par->color_trc;
+    info.colorSpace = par->color_space;
+    info.chromaLocation = par->chroma_location;
+    info.videoDelay = par->video_delay;
+    info.channelLayout = par->channel_layout;
+    info.channels = par->channels;
+    info.sampleRate = par->sample_rate;
+    info.blockAlign = par->block_align;
+    info.frameSize = par->frame_size;
+    info.initialPadding = par->initial_padding;
+    info.trailingPadding = par->trailing_padding;
+    info.seekPreroll = par->seek_preroll;
+    info.timeBase = st->time_base;
+    info.avgFrameRate = st->avg_frame_rate;
+    info.rFrameRate = st->r_frame_rate;
+    info.startTime = st->start_time;
+    info.duration = st->duration;
+    AVDictionaryEntry *lang = av_dict_get(st->metadata, "language", nullptr, 0);
+    if (lang && lang->value)
+      info.language = QString::fromUtf8(lang->value);
+    streams.push_back(info);
+  }
+  m_streams.swap(streams);
+  m_duration = fmtCtx->duration;
+  m_startTime = fmtCtx->start_time;
+  m_bitRate = fmtCtx->bit_rate;
+  m_loaded = true;
+  m_valid = true;
+  save();
+  MediaCache::trim();
+}
+
+bool ProbeCache::load() {
+  QString cachePath = MediaCache::filePath(m_path, "probe");
+  QFile file(cachePath);
+  if (!file.open(QIODevice::ReadOnly))
+    return false;
+  QDataStream in(&file);
+  quint32 magic = 0, version = 0, count = 0;
+  in >> magic >> version >> count;
+  if (magic != PROBE_MAGIC || version != PROBE_VERSION || count == 0 ||
+      count > quint32(MAX_STREAMS))
+    return false;
+  in >> m_duration >> m_startTime >> m_bitRate;
+
+  std::vector<StreamInfo> streams(count);
+  for (StreamInfo &info : streams) {
+    qint32 codecType = 0, codecId = 0;
+    in >> codecType >> codecId >> info.codecTag >> info.extradata >>
+        info.format >> info.bitRate >> info.bitsPerCodedSample >>
+        info.bitsPerRawSample >> info.profile >> info.level >> info.width >>
+        info.height >> info.sampleAspectRatio >> info.fieldOrder >>
+        info.colorRange >> info.colorPrimaries >> info.colorTrc >>
+        info.colorSpace >> info.chromaLocation >> info.videoDelay >>
+        info.channelLayout >> info.channels >> info.sampleRate >>
+        info.blockAlign >> info.frameSize >> info.initialPadding >>
+        info.trailingPadding >> info.seekPreroll >> info.timeBase >>
+        info.avgFrameRate >> info.rFrameRate >> info.startTime >>
+        info.duration >> info.language;
+    info.codecType = AVMediaType(codecType);
+    info.codecId = AVCodecID(codecId);
+  }
+  if (in.status() != QDataStream::Ok)
+    return false;
+  m_streams.swap(streams);
+  MediaCache::touch(cachePath);
+  return true;
+}
+
+void ProbeCache::save() const {
+  QString cachePath = MediaCache::filePath(m_path, "probe");
+  QSaveFile file(cachePath);
+  if (!file.open(QIODevice::WriteOnly))
+    return;
+  QDataStream out(&file);
+  out << PROBE_MAGIC << PROBE_VERSION << quint32(m_streams.size())
+      << m_duration << m_startTime << m_bitRate;
+  for (const StreamInfo &info : m_streams) {
+    out << qint32(info.codecType) << qint32(info.codecId) << info.codecTag
+        << info.extradata << info.format << info.bitRate
+        << info.bitsPerCodedSample << info.bitsPerRawSample << info.profile
+        << info.level << info.width << info.height << info.sampleAspectRatio
+        << info.fieldOrder << info.colorRange << info.colorPrimaries
+        << info.colorTrc << info.colorSpace << info.chromaLocation
+        << info.videoDelay << info.channelLayout << info.channels
+        << info.sampleRate << info.blockAlign << info.frameSize
+        << info.initialPadding << info.trailingPadding << info.seekPreroll
+        << info.timeBase << info.avgFrameRate << info.rFrameRate
+        << info.startTime << info.duration << info.language;
+  }
+  if (!file.commit())
+    qWarning() << "Probe cache: failed to write" << cachePath;
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include "FFmpegUtils.h"
+#include <QByteArray>
+#include <QString>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 媒体探测结果（流信息）的持久缓存
+// avformat_find_stream_info 要从每一路流解码若干帧才能补全编码参数，打开一次
+// 往往要几百毫秒。这里把探测后的流布局、编码参数、时长和语言标签保存到磁盘缓存，
+// 同一文件（路径、大小、修改时间均未变）再次打开时直接回填，跳过探测。
+// 内存中保留最近一次的结果，视频和音频线程打开同一文件时只探测一次。
+// 首次打开只探测要播放的流时不写缓存，用户打开轨道菜单时才在后台补全全部流
+// 并写入，不与起播争用 I/O。
+class ProbeCache {
+public:
+  ~ProbeCache();
+
+  // 切换到新文件时调用，清除内存中的结果
+  void reset(const QString &path);
+
+  // 用缓存补全刚打开的输入；没有缓存或与文件头不一致时返回 false，需正常探测
+  bool apply(AVFormatContext *fmtCtx);
+
+  // 保存探测完成的输入的流信息
+  void store(AVFormatContext *fmtCtx);
+
+  // 结果是否来自磁盘缓存（即本次为热打开）
+  bool warm() const;
+
+  // 还没有完整探测结果时在后台完整探测一次并写入缓存；完成后在后台线程调用
+  // probed，传入探测完的输入
+  void probeInBackground(
+      const std::function<void(const AVFormatContext *)> &probed = nullptr);
+  void stop();
+
+private:
+  struct StreamInfo {
+    AVMediaType codecType;
+    AVCodecID codecId;
+    quint32 codecTag;
+    QByteArray extradata;
+    int format;
+    qint64 bitRate;
+    int bitsPerCodedSample;
+    int bitsPerRawSample;
+    int profile;
+    int level;
+    int width;
+    int height;
+    AVRational sampleAspectRatio;
+    int fieldOrder;
+    int colorRange;
+    int colorPrimaries;
+    int colorTrc;
+    int colorSpace;
+    int chromaLocation;
+    int videoDelay;
+    quint64 channelLayout;
+    int channels;
+    int sampleRate;
+    int blockAlign;
+    int frameSize;
+    int initialPadding;
+    int trailingPadding;
+    int seekPreroll;
+    AVRational timeBase;
+    AVRational avgFrameRate;
+    AVRational rFrameRate;
+    qint64 startTime;
+    qint64 duration;
+    QString language;
+  };
+
+  void run(QString path,
+           std::function<void(const AVFormatContext *)> probed);
+  bool load();
+  void save() const;
+  static bool cacheable(const AVFormatContext *fmtCtx);
+
+  std::thread m_thread; // 由 m_mutex 保护：界面和解码线程都可能启动探测
+  std::atomic<bool> m_stop{false};
+  mutable std::mutex m_mutex;
+  QString m_path;
+  bool m_loaded = false; // 已尝试过读取磁盘缓存
+  bool m_valid = false;
+  bool m_warm = false;
+  qint64 m_duration = 0;
+  qint64 m_startTime = 0;
+  qint64 m_bitRate = 0;
+  std::vector<StreamInfo> m_streams;
+};
@@ -0,0 +1,269 @@
+#include "ProxyTranscoder.h"
+#include "MediaCache.h"
+#include "PlayerLog.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <algorithm>
+
+std::atomic<bool> ProxyTranscoder::s_enabled{false};
+
+ProxyTranscoder::~ProxyTranscoder() { stop(); }
+
+void ProxyTranscoder::setEnabled(bool enabled) { s_enabled = enabled; }
+
+bool ProxyTranscoder::enabled() { return s_enabled; }
+
+void ProxyTranscoder::open(const QString &path, int streamIndex, int width,
+                           int height, int maxWidth, int maxHeight) {
+  stop();
+  m_stop = false;
+  m_streamIndex = streamIndex;
+  m_path = path;
+  m_maxWidth = maxWidth;
+  m_maxHeight = maxHeight;
+  fit_within(width, height, maxWidth, maxHeight, m_width, m_height);
+  m_width &= ~1;
+  m_height &= ~1;
+  // 缓存名带上代理尺寸，换了显示尺寸的设备不会用到不合适的代理
+  m_proxyPath = MediaCache::filePath(
+      path, QString("s%1.%2x%3.proxy.mkv")
+                .arg(streamIndex)
+                .arg(m_width)
+                .arg(m_height));
+  m_decodeMs = 0;
+  m_decodedMs = 0;
+  m_mediaMs = 0;
+  m_degraded = false;
+  m_measuring = false;
+  if (QFile::exists(m_proxyPath)) {
+    qCDebug(lcPlayer) << "Proxy: using cached" << m_proxyPath;
+    MediaCache::touch(m_proxyPath);
+    m_ready = true;
+    return;
+  }
+  m_measuring = m_width > 0 && m_height > 0;
+}
+
+void ProxyTranscoder::report(double decodeMs, int frameIntervalMs,
+                             bool degraded) {
+  if (!m_measuring)
+    return;
+  m_mediaMs += frameIntervalMs;
+  if (degraded)
+    m_degraded = true;
+  else {
+    m_decodeMs += decodeMs;
+    m_decodedMs += frameIntervalMs;
+  }
+  if (m_mediaMs < PROBE_MS)
+    return;
+
+  m_measuring = false;
+  double speed = m_decodeMs > 0 ? m_decodedMs / m_decodeMs : 0;
+  qCDebug(lcPlayer) << "Proxy: playback decode throughput" << speed
+                    << "x realtime" << (m_degraded ? "(degraded)" : "");
+  if (!m_degraded && (speed <= 0 || speed >= 1.0))
+    return;
+  m_thread = std::thread(&ProxyTranscoder::run, this, m_path);
+}
+
+void ProxyTranscoder::stop() {
+  m_stop = true;
+  if (m_thread.joinable())
+    m_thread.join();
+  m_ready = false;
+  m_measuring = false;
+  m_streamIndex = -1;
+}
+
+void ProxyTranscoder::discard() {
+  m_ready = false;
+  QFile::remove(m_proxyPath);
+}
+
+void ProxyTranscoder::run(QString path) {
+  MediaCache::setBackgroundPriority();
+  const int streamIndex = m_streamIndex;
+
+  AVFormatContext *raw_fmt_ctx = nullptr;
+  if (avformat_open_input(&raw_fmt_ctx, path.toUtf8().constData(), nullptr,
+                          nullptr) < 0)
+    return;
+  AVFormatContextPtr fmtCtx(raw_fmt_ctx);
+  if (avformat_find_stream_info(fmtCtx.get(), nullptr) < 0 ||
+      streamIndex >= int(fmtCtx->nb_streams))
+    return;
+  for (unsigned i = 0; i < fmtCtx->nb_streams; i++) {
+    if (int(i) != streamIndex)
+      fmtCtx->streams[i]->discard = AVDISCARD_ALL;
+  }
+
+  // 按代理尺寸和帧率估算输出大小，放不进磁盘缓存的不转码
+  AVStream *stream = fmtCtx->streams[streamIndex];
+  AVRational rate = stream->avg_frame_rate;
+  double fps = rate.num && rate.den ? std::min(av_q2d(rate), 120.0) : 25.0;
+  double seconds = fmtCtx->duration > 0 ? fmtCtx->duration / double(AV_TIME_BASE)
+                                        : 0;
+  qint64 estimate = qint64(double(m_width) * m_height * fps * seconds *
+                           PROXY_BITS_PER_PIXEL / 8);
+  if (estimate > MediaCache::DEFAULT_MAX_BYTES) {
+    qCDebug(lcPlayer) << "Proxy: estimated" << estimate / (1024 * 1024)
+                      << "MB exceeds the cache limit, not transcoding";
+    return;
+  }
+
+  AVCodec *codec = find_decoder(stream->codecpar->codec_id, AVMEDIA_TYPE_VIDEO);
+  AVCodecContextPtr dec = codec ? make_avcodec_ctx(codec) : AVCodecContextPtr();
+  if (!dec ||
+      avcodec_parameters_to_context(dec.get(), stream->codecpar) < 0)
+    return;
+  dec->lowres = choose_lowres(codec, stream->codecpar->width,
+                              stream->codecpar->height, m_maxWidth,
+                              m_maxHeight);
+  if (avcodec_open2(dec.get(), codec, nullptr) < 0)
+    return;
+
+  // 先写临时文件，完成后再改名，中途退出不会留下残缺的代理
+  QString tmpPath = m_proxyPath + ".part";
+  QElapsedTimer timer;
+  timer.start();
+  if (!transcode(fmtCtx.get(), dec.get(), tmpPath)) {
+    QFile::remove(tmpPath);
+    return;
+  }
+  QFile::remove(m_proxyPath);
+  if (!QFile::rename(tmpPath, m_proxyPath)) {
+    QFile::remove(tmpPath);
+    return;
+  }
+  qCDebug(lcPlayer) << "Proxy: transcoded" << m_width << "x" << m_height
+                    << "in" << timer.elapsed() << "ms ->" << m_proxyPath;
+  MediaCache::trim();
+  m_ready = QFile::exists(m_proxyPath);
+}
+
+bool ProxyTranscoder::transcode(AVFormatContext *fmtCtx, AVCodecContext *dec,
+                                const QString &outPath) {
+  const int streamIndex = m_streamIndex;
+  const int width = m_width;
+  const int height = m_height;
+  AVStream *inStream = fmtCtx->streams[streamIndex];
+  QByteArray outName = outPath.toUtf8();
+
+  AVFormatContext *raw_out = nullptr;
+  if (avformat_alloc_output_context2(&raw_out, nullptr, "matroska",
+                                     outName.constData()) < 0)
+    return false;
+  // 输出上下文由 avformat_free_context 释放，这里不能用 AVFormatContextPtr
+  std::unique_ptr<AVFormatContext, void (*)(AVFormatContext *)> out(
+      raw_out, [](AVFormatContext *ctx) {
+        if (ctx->pb)
+          avio_closep(&ctx->pb);
+        avformat_free_context(ctx);
+      });
+
+  AVCodec *encoder = avcodec_find_encoder(AV_CODEC_ID_MPEG4);
+  AVCodecContextPtr enc = encoder ? make_avcodec_ctx(encoder) : AVCodecContextPtr();
+  if (!enc)
+    return false;
+  // MPEG-4 时间基分母不能超过 16 位，按帧率取时间基
+  AVRational rate = inStream->avg_frame_rate;
+  if (!rate.num || !rate.den || av_q2d(rate) > 120)
+    rate = {25, 1};
+  enc->width = width;
+  enc->height = height;
+  enc->pix_fmt = AV_PIX_FMT_YUV420P;
+  enc->time_base = av_inv_q(rate);
+  enc->gop_size = PROXY_GOP;
+  enc->max_b_frames = 0; // 不用 B 帧，解码最省
+  enc->flags |= AV_CODEC_FLAG_QSCALE;
+  enc->global_quality = FF_QP2LAMBDA * PROXY_QSCALE;
+  if (out->oformat->flags & AVFMT_GLOBALHEADER)
+    enc->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+  if (avcodec_open2(enc.get(), encoder, nullptr) < 0)
+    return false;
+
+  AVStream *outStream = avformat_new_stream(out.get(), nullptr);
+  if (!outStream ||
+      avcodec_parameters_from_context(outStream->codecpar, enc.get()) < 0)
+    return false;
+  outStream->time_base = enc->time_base;
+  if (avio_open(&out->pb, outName.constData(), AVIO_FLAG_WRITE) < 0 ||
+      avformat_write_header(out.get(), nullptr) < 0)
+    return false;
+
+  AVFramePtr yuv = make_avframe();
+  yuv->format = AV_PIX_FMT_YUV420P;
+  yuv->width = width;
+  yuv->height = height;
+  if (av_frame_get_buffer(yuv.get(), 32) < 0)
+    return false;
+
+  SwsContext *sws = nullptr;
+  AVPacketPtr pkt = make_avpacket();
+  AVPacketPtr outPkt = make_avpacket();
+  AVFramePtr frame = make_avframe();
+  int64_t lastPts = AV_NOPTS_VALUE;
+  qint64 durationMs = fmtCtx->duration > 0 ? fmtCtx->duration / 1000 : 0;
+  int lastPercent = -1;
+  bool ok = true;
+
+  auto writePackets = [&]() {
+    while (avcodec_receive_packet(enc.get(), outPkt.get()) == 0) {
+      av_packet_rescale_ts(outPkt.get(), enc->time_base, outStream->time_base);
+      outPkt->stream_index = outStream->index;
+      if (av_interleaved_write_frame(out.get(), outPkt.get()) < 0)
+        ok = false;
+      // 估算偏低时在写满缓存上限前放弃
+      if (avio_tell(out->pb) > MediaCache::DEFAULT_MAX_BYTES)
+        ok = false;
+    }
+  };
+  auto encodeFrames = [&]() {
+    while (ok && avcodec_receive_frame(dec, frame.get()) == 0) {
+      int64_t pts = frame->best_effort_timestamp;
+      if (pts != AV_NOPTS_VALUE) {
+        // 保留原始时间戳，代理与原文件的音频和字幕时间一致
+        int64_t encPts = av_rescale_q(pts, inStream->time_base, enc->time_base);
+        if (lastPts == AV_NOPTS_VALUE || encPts > lastPts) {
+          sws = sws_getCachedContext(sws, frame->width, frame->height,
+                                     (AVPixelFormat)frame->format, width,
+                                     height, AV_PIX_FMT_YUV420P, SWS_BILINEAR,
+                                     nullptr, nullptr, nullptr);
+          if (sws && av_frame_make_writable(yuv.get()) >= 0) {
+            sws_scale(sws, frame->data, frame->linesize, 0, frame->height,
+                      yuv->data, yuv->linesize);
+            yuv->pts = lastPts = encPts;
+            avcodec_send_frame(enc.get(), yuv.get());
+            writePackets();
+          }
+        }
+        if (durationMs > 0) {
+          int percent = int(av_rescale_q(pts, inStream->time_base, {1, 1000}) *
+                            100 / durationMs);
+          if (percent / 10 != lastPercent / 10)
+            qCDebug(lcPlayer) << "Proxy: transcoding" << percent << "%";
+          lastPercent = percent;
+        }
+      }
+      av_frame_unref(frame.get());
+    }
+  };
+
+  while (ok && !m_stop && av_read_frame(fmtCtx, pkt.get()) >= 0) {
+    if (pkt->stream_index == streamIndex)
+      avcodec_send_packet(dec, pkt.get());
+    av_packet_unref(pkt.get());
+    encodeFrames();
+  }
+  if (ok && !m_stop) {
+    avcodec_send_packet(dec, nullptr);
+    encodeFrames();
+    avcodec_send_frame(enc.get(), nullptr);
+    writePackets();
+    ok = av_write_trailer(out.get()) >= 0;
+  }
+  if (sws)
+    sws_freeContext(sws);
+  return ok && !m_stop;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include "FFmpegUtils.h"
+#include <QString>
+#include <atomic>
+#include <thread>
+
+// 实时解码不了的文件的代理转码（代理模式，默认关闭）
+// 播放时统计播放解码器自身的每帧解码耗时，全速解码的吞吐低于实时、或解码质量已被
+// 迫降到跳过非参考帧时，在后台把该视频流转码为屏幕分辨率、关键帧间隔很短的
+// MPEG-4 Part 2（Matroska 封装）代理文件，保存到磁盘缓存。
+// 代理保留原始时间戳，播放时只替换视频，音频和字幕仍来自原文件。
+// 预计大小超过磁盘缓存上限的文件不转码，否则转完即被淘汰。
+class ProxyTranscoder {
+public:
+  ~ProxyTranscoder();
+
+  // 代理模式开关，需在播放前设置
+  static void setEnabled(bool enabled);
+  static bool enabled();
+
+  // 开始播放某路视频（源尺寸 width × height）：已有缩放到同一显示尺寸的代理缓存时
+  // 立即就绪，否则开始统计吞吐
+  void open(const QString &path, int streamIndex, int width, int height,
+            int maxWidth, int maxHeight);
+  // 视频线程每显示一帧调用一次：decodeMs 为该帧的解码耗时，degraded 表示解码
+  // 质量已降到跳过非参考帧或更低。统计满 PROBE_MS 后决定是否转码，只决定一次
+  void report(double decodeMs, int frameIntervalMs, bool degraded);
+  void stop();
+
+  bool ready() const { return m_ready; }
+  int sourceStream() const { return m_streamIndex; }
+  QString proxyPath() const { return m_proxyPath; }
+
+  // 代理文件损坏时放弃使用
+  void discard();
+
+private:
+  static const int PROBE_MS = 3000;  // 统计吞吐的媒体时长
+  static const int PROXY_GOP = 12;   // 代理关键帧间隔，保证跳转快
+  static const int PROXY_QSCALE = 5; // 固定量化参数
+  // 估算代理大小用的码率：每像素每帧的比特数（qscale 5 的 MPEG-4 实测约 0.1~0.2）
+  static constexpr double PROXY_BITS_PER_PIXEL = 0.2;
+
+  void run(QString path);
+  bool transcode(AVFormatContext *fmtCtx, AVCodecContext *dec,
+                 const QString &outPath);
+
+  static std::atomic<bool> s_enabled;
+
+  std::thread m_thread;
+  std::atomic<bool> m_stop{false};
+  std::atomic<bool> m_ready{false};
+  std::atomic<int> m_streamIndex{-1};
+  QString m_path;
+  QString m_proxyPath;
+  int m_width = 0; // 代理尺寸
+  int m_height = 0;
+  int m_maxWidth = 0; // 显示尺寸，转码时据此选择 lowres
+  int m_maxHeight = 0;
+
+  // 吞吐统计，只由视频线程访问
+  bool m_measuring = false;
+  double m_decodeMs = 0;  // 全速解码的帧累计的解码耗时
+  qint64 m_decodedMs = 0; // 这些帧覆盖的媒体时长
+  qint64 m_mediaMs = 0;   // 统计期间显示的全部帧的媒体时长
+  bool m_degraded = false;
+};
@@ -7,7 +7,7 @@
 SubtitleManager::SubtitleManager()
     : currentSubtitleIndex(-1), hasAssSubtitle(false), assTrack(nullptr) {}
 
-void SubtitleManager::loadSubtitle(const QString &path, ASS_Library *assLibrary, ASS_Renderer *assRenderer) {
+void SubtitleManager::loadSubtitle(const QString &path, AssEngine *assEngine) {
   // 加载字幕（支持模糊匹配）
   QString basePath =
       QFileInfo(path).absolutePath() + "/" + QFileInfo(path).completeBaseName();
@@ -15,12 +15,12 @@ void SubtitleManager::loadSubtitle(const QString &path, ASS_Library *assLibrary,
   QString srtPath = basePath + ".srt";
   QString subtitlePath;
   if (QFile::exists(assPath)) {
-    loadAssSubtitle(assPath, assLibrary, assRenderer);
+    loadAssSubtitle(assPath, assEngine);
   } else if (QFile::exists(srtPath)) {
     loadSrtSubtitle(srtPath);
   } else if (findSimilarSubtitle(path, subtitlePath)) {
     if (subtitlePath.endsWith(".ass", Qt::CaseInsensitive)) {
-      loadAssSubtitle(subtitlePath, assLibrary, assRenderer);
+      loadAssSubtitle(subtitlePath, assEngine);
     } else if (subtitlePath.endsWith(".srt", Qt::CaseInsensitive)) {
       loadSrtSubtitle(subtitlePath);
     }
@@ -64,20 +64,24 @@ void SubtitleManager::loadSrtSubtitle(const QString &path) {
 }
 
 void SubtitleManager::loadAssSubtitle(const QString &path,
-                                      ASS_Library *assLibrary,
-                                      ASS_Renderer *assRenderer) {
+                                      AssEngine *assEngine) {
   hasAssSubtitle = false;
-  if (!assLibrary || !assRenderer)
-    return;
   QFile f(path);
   if (!f.open(QIODevice::ReadOnly | QIODevice::Text))
     return;
+  // 真正有 ASS 字幕时才初始化 libass
+  ASS_Library *assLibrary = assEngine ? assEngine->library() : nullptr;
+  if (!assLibrary)
+    return;
   if (assTrack) {
     ass_free_track(assTrack);
     assTrack = nullptr;
   }
   assTrack = ass_read_file(assLibrary, path.toUtf8().constData(), nullptr);
   hasAssSubtitle = (assTrack != nullptr);
+  // 读取完成后再在后台创建渲染器、加载字体
+  if (hasAssSubtitle)
+    assEngine->startRenderer();
 }
 
 void SubtitleManager::updateSubtitleIndex(qint64 pts) {
@@ -4,6 +4,8 @@
 #include <QRegExp>
 #include <ass/ass.h>
 
+#include "AssEngine.h"
+
 struct SubtitleLine {
     qint64 startTime;
     qint64 endTime;
@@ -14,9 +16,9 @@ struct SubtitleLine {
 class SubtitleManager {
 public:
     SubtitleManager();
-    void loadSubtitle(const QString &path, ASS_Library *assLibrary, ASS_Renderer *assRenderer);
+    void loadSubtitle(const QString &path, AssEngine *assEngine);
     void loadSrtSubtitle(const QString &path);
-    void loadAssSubtitle(const QString &path, ASS_Library *assLibrary, ASS_Renderer *assRenderer);
+    void loadAssSubtitle(const QString &path, AssEngine *assEngine);
     void updateSubtitleIndex(qint64 pts);
     bool findSimilarSubtitle(const QString &videoPath, QString &subtitlePath);
     int levenshteinDistance(const QString &s1, const QString &s2);
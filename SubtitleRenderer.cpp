@@ -6,8 +6,8 @@
 #include <QImage>
 #include <QPainterPath>
 
-SubtitleRenderer::SubtitleRenderer(SubtitleManager* manager, ASS_Renderer* assRenderer)
-    : subtitleManager(manager), assRenderer(assRenderer) {}
+SubtitleRenderer::SubtitleRenderer(SubtitleManager* manager, TextCueCache* cueCache, ASS_Renderer* assRenderer)
+    : subtitleManager(manager), cueCache(cueCache), assRenderer(assRenderer) {}
 
 void SubtitleRenderer::setAssRenderer(ASS_Renderer* renderer) {
     assRenderer = renderer;
@@ -17,12 +17,16 @@ void SubtitleRenderer::drawSrtSubtitles(QPainter &p, const QRect &lyricRect, int
     QString subText;
     const auto &subs = subtitleManager->getSubtitles();
     int curIdx = subtitleManager->getCurrentSubtitleIndex();
+    int pointSize = overlayFontSize - 2;
+    if (curIdx != lastSubIdx) {
+        // 字幕切换时在后台预渲染接下来的几条
+        lastSubIdx = curIdx;
+        prefetchUpcoming(currentPts, pointSize, lyricRect.width());
+    }
     if (curIdx >= 0 && curIdx < subs.size()) {
         subText = subs[curIdx].text;
-        lastSubIdx = curIdx;
         lastSubText = subText;
     } else {
-        lastSubIdx = -2;
         lastSubText.clear();
         return;
     }
@@ -44,48 +48,54 @@ void SubtitleRenderer::drawSrtSubtitles(QPainter &p, const QRect &lyricRect, int
             if (alpha < 0) alpha = 0;
             if (alpha > 255) alpha = 255;
         }
-        QFont subFont("Microsoft YaHei", overlayFontSize - 2, QFont::Bold);
-        p.setFont(subFont);
-        QRect textRect = p.fontMetrics().boundingRect(
-            lyricRect, Qt::AlignHCenter | Qt::AlignVCenter, subText);
-        textRect = textRect.marginsAdded(QMargins(10, 8, 10, 8));
+        // 文字和背景已渲染好，淡入淡出只改贴图透明度
+        QImage cue = cueCache->cue(subText, pointSize, lyricRect.width());
+        if (cue.isNull() || alpha <= 0)
+            return;
+        QRect textRect(QPoint(0, 0), cue.size());
         textRect.moveCenter(lyricRect.center());
         p.save();
-        p.setRenderHint(QPainter::Antialiasing, true);
-        QColor bgColor(0, 0, 0, alpha * 180 / 255); // 背景透明度同步
-        p.setPen(Qt::NoPen);
-        p.setBrush(bgColor);
-        p.drawRoundedRect(textRect, 12, 12);
-        p.restore();
-        p.save();
-        QColor textColor(255, 255, 255, alpha);
-        p.setPen(textColor);
-        p.drawText(textRect, Qt::AlignHCenter | Qt::AlignVCenter, subText);
+        p.setOpacity(alpha / 255.0);
+        p.drawImage(textRect.topLeft(), cue);
         p.restore();
     }
 }
 
+void SubtitleRenderer::prefetchUpcoming(qint64 currentPts, int pointSize, int width) {
+    const auto &subs = subtitleManager->getSubtitles();
+    int queued = 0;
+    for (int i = 0; i < subs.size() && queued < PREFETCH_CUES; ++i) {
+        if (subs[i].startTime > currentPts) {
+            cueCache->prefetch(subs[i].text, pointSize, width);
+            ++queued;
+        }
+    }
+}
+
 void SubtitleRenderer::drawAssSubtitles(QPainter &p, int w, int h, qint64 currentPts) {
     if (subtitleManager->hasAss() && subtitleManager->getAssTrack() && assRenderer) {
-        ass_set_frame_size(assRenderer, w, h);
-        int detectChange = 0;
-        ASS_Image *img =
-            ass_render_frame(assRenderer, subtitleManager->getAssTrack(), currentPts, &detectChange);
-        for (; img; img = img->next) {
-            QImage qimg((const uchar *)img->bitmap, img->w, img->h, img->stride,
-                        QImage::Format_Alpha8);
-            QColor color;
-            color.setRgba(qRgba((img->color >> 24) & 0xFF, (img->color >> 16) & 0xFF,
-                                (img->color >> 8) & 0xFF, 255 - (img->color & 0xFF)));
-            QImage colored(qimg.size(), QImage::Format_ARGB32_Premultiplied);
-            colored.fill(Qt::transparent);
-            QPainter qp(&colored);
-            qp.setCompositionMode(QPainter::CompositionMode_Source);
-            qp.fillRect(qimg.rect(), color);
-            qp.setCompositionMode(QPainter::CompositionMode_DestinationIn);
-            qp.drawImage(0, 0, qimg);
-            qp.end();
-            p.drawImage(img->dst_x, img->dst_y, colored);
-        }
+        // 由后台线程提前渲染，这里按时间戳取就绪的图像
+        ASS_Track *track = subtitleManager->getAssTrack();
+        if (!assPrerender.running() || assPrerender.track() != track)
+            assPrerender.start(assRenderer, track);
+        QImage image;
+        QPoint pos;
+        if (assPrerender.frame(currentPts, QSize(w, h), image, pos))
+            p.drawImage(pos, image);
     }
 }
+
+void SubtitleRenderer::stopPrerender() {
+    assPrerender.stop();
+}
+
+bool SubtitleRenderer::assChangedAt(qint64 pts) {
+    if (!assPrerender.running() ||
+        assPrerender.track() != subtitleManager->getAssTrack())
+        return true;
+    return assPrerender.changedAt(pts);
+}
+
+void SubtitleRenderer::setPrerenderReadyCallback(const std::function<void()> &ready) {
+    assPrerender.setReadyCallback(ready);
+}
@@ -2,18 +2,31 @@
 #include <QPainter>
 #include <QRect>
 #include <QElapsedTimer>
+#include "AssPrerenderer.h"
 #include "SubtitleManager.h"
+#include "TextCueCache.h"
 #include <ass/ass.h>
 
 class SubtitleRenderer {
 public:
-    SubtitleRenderer(SubtitleManager* manager, ASS_Renderer* assRenderer = nullptr);
+    SubtitleRenderer(SubtitleManager* manager, TextCueCache* cueCache, ASS_Renderer* assRenderer = nullptr);
     void drawSrtSubtitles(QPainter &p, const QRect &lyricRect, int overlayFontSize, qint64 currentPts);
     void drawAssSubtitles(QPainter &p, int width, int height, qint64 currentPts);
     void setAssRenderer(ASS_Renderer* renderer);
+    // 停止 ASS 预渲染线程；释放字幕轨道或 libass 渲染器之前调用
+    void stopPrerender();
+    // pts 时刻的 ASS 字幕图像是否与上次绘制的不同（预渲染还没开始时为 true）
+    bool assChangedAt(qint64 pts);
+    // ASS 预渲染补上未命中的帧后调用（在后台线程）
+    void setPrerenderReadyCallback(const std::function<void()> &ready);
 private:
+    static const int PREFETCH_CUES = 2; // 字幕切换时预渲染的后续条数
+    void prefetchUpcoming(qint64 currentPts, int pointSize, int width);
+
     SubtitleManager* subtitleManager;
+    TextCueCache* cueCache;
     ASS_Renderer* assRenderer;
+    AssPrerenderer assPrerender; // ASS 字幕后台预渲染
     // 状态变量
     int lastSubIdx = -2;
     qreal fadeOpacity = 1.0;
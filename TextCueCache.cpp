@@ -0,0 +1,123 @@
+#include "TextCueCache.h"
+#include <QFont>
+#include <QFontMetrics>
+#include <QPainter>
+
+TextCueCache::~TextCueCache() { stop(); }
+
+QString TextCueCache::key(const QString &text, int pointSize, int width) {
+  return QString("%1:%2:%3").arg(pointSize).arg(width).arg(text);
+}
+
+QImage TextCueCache::render(const QString &text, int pointSize, int width) {
+  QFont font("Microsoft YaHei", pointSize, QFont::Bold);
+  QFontMetrics fm(font);
+  QRect textRect = fm.boundingRect(QRect(0, 0, width, 0),
+                                   Qt::AlignHCenter | Qt::AlignVCenter, text);
+  textRect = textRect.marginsAdded(QMargins(10, 8, 10, 8));
+  if (textRect.isEmpty())
+    return QImage();
+
+  QImage image(textRect.size(), QImage::Format_ARGB32_Premultiplied);
+  if (image.isNull())
+    return image;
+  image.fill(Qt::transparent);
+  QPainter p(&image);
+  p.setRenderHint(QPainter::Antialiasing, true);
+  // 背景与文字都按完全显示时的颜色绘制，淡入淡出由贴图透明度控制
+  p.setPen(Qt::NoPen);
+  p.setBrush(QColor(0, 0, 0, 180));
+  p.drawRoundedRect(image.rect(), 12, 12);
+  p.setFont(font);
+  p.setPen(Qt::white);
+  p.drawText(image.rect(), Qt::AlignHCenter | Qt::AlignVCenter, text);
+  return image;
+}
+
+QImage TextCueCache::cue(const QString &text, int pointSize, int width) {
+  QString k = key(text, pointSize, width);
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    auto it = m_cues.find(k);
+    if (it != m_cues.end()) {
+      it.value().lastUse = ++m_useCounter;
+      return it.value().image;
+    }
+  }
+  // 后台还没渲染到，当场渲染
+  QImage image = render(text, pointSize, width);
+  insert(k, image);
+  return image;
+}
+
+void TextCueCache::prefetch(const QString &text, int pointSize, int width) {
+  if (text.isEmpty())
+    return;
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    if (m_cues.contains(key(text, pointSize, width)))
+      return;
+    for (const Request &r : m_pending) {
+      if (r.text == text && r.pointSize == pointSize && r.width == width)
+        return;
+    }
+    if (m_pending.size() >= MAX_PENDING)
+      m_pending.pop_front();
+    m_pending.push_back({text, pointSize, width});
+    if (!m_thread.joinable()) {
+      m_quit = false;
+      m_thread = std::thread(&TextCueCache::run, this);
+    }
+  }
+  m_cond.notify_one();
+}
+
+void TextCueCache::insert(const QString &key, const QImage &image) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  if (m_cues.size() >= MAX_CUES && !m_cues.contains(key)) {
+    // 淘汰最久未使用的一条
+    auto oldest = m_cues.begin();
+    for (auto it = m_cues.begin(); it != m_cues.end(); ++it) {
+      if (it.value().lastUse < oldest.value().lastUse)
+        oldest = it;
+    }
+    m_cues.erase(oldest);
+  }
+  Entry &entry = m_cues[key];
+  entry.image = image;
+  entry.lastUse = ++m_useCounter;
+}
+
+void TextCueCache::clear() {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_pending.clear();
+  m_cues.clear();
+}
+
+void TextCueCache::stop() {
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_quit = true;
+    m_pending.clear();
+  }
+  m_cond.notify_one();
+  if (m_thread.joinable())
+    m_thread.join();
+}
+
+void TextCueCache::run() {
+  std::unique_lock<std::mutex> lk(m_mutex);
+  while (true) {
+    m_cond.wait(lk, [this] { return m_quit || !m_pending.empty(); });
+    if (m_quit)
+      break;
+    Request req = m_pending.front();
+    m_pending.pop_front();
+    if (m_cues.contains(key(req.text, req.pointSize, req.width)))
+      continue;
+    lk.unlock();
+    QImage image = render(req.text, req.pointSize, req.width);
+    insert(key(req.text, req.pointSize, req.width), image);
+    lk.lock();
+  }
+}
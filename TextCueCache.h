@@ -0,0 +1,53 @@
+#pragma once
+#include <QHash>
+#include <QImage>
+#include <QString>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// 字幕、歌词文字的光栅化缓存
+// 一条字幕要在屏幕上停留几秒，每次绘制都重新创建字体、测量和排版中文文字很浪费。
+// 每条文字连同圆角背景只渲染一次，按文字、字号、区域宽度缓存为预乘 alpha 图像，
+// 淡入淡出在贴图时用透明度实现。即将出现的字幕由后台线程提前渲染。
+class TextCueCache {
+public:
+  ~TextCueCache();
+
+  // 取一条文字的图像，不在缓存中时当场渲染
+  QImage cue(const QString &text, int pointSize, int width);
+
+  // 请求后台渲染，已缓存或已在队列中的直接忽略
+  void prefetch(const QString &text, int pointSize, int width);
+
+  void clear(); // 换文件时清空
+  void stop();
+
+private:
+  static const int MAX_CUES = 16;    // 缓存的文字条数
+  static const int MAX_PENDING = 8;  // 后台队列长度
+
+  struct Request {
+    QString text;
+    int pointSize;
+    int width;
+  };
+  struct Entry {
+    QImage image;
+    quint64 lastUse = 0;
+  };
+
+  static QString key(const QString &text, int pointSize, int width);
+  static QImage render(const QString &text, int pointSize, int width);
+  void insert(const QString &key, const QImage &image);
+  void run();
+
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  QHash<QString, Entry> m_cues;
+  quint64 m_useCounter = 0;
+  std::deque<Request> m_pending;
+  std::thread m_thread;
+  bool m_quit = false;
+};
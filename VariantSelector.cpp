@@ -0,0 +1,137 @@
+#include "VariantSelector.h"
+#include "PlayerLog.h"
+#include <algorithm>
+#include <cstring>
+
+constexpr double VariantSelector::DOWN_LOAD;
+constexpr double VariantSelector::TARGET_LOAD;
+constexpr double VariantSelector::NET_MARGIN;
+
+namespace {
+// hls 解复用器把变体带宽写在流和节目的元数据中
+qint64 variant_bitrate(AVFormatContext *fmtCtx, unsigned index) {
+  AVDictionaryEntry *e =
+      av_dict_get(fmtCtx->streams[index]->metadata, "variant_bitrate", nullptr, 0);
+  for (unsigned p = 0; !e && p < fmtCtx->nb_programs; p++) {
+    AVProgram *program = fmtCtx->programs[p];
+    for (unsigned i = 0; i < program->nb_stream_indexes; i++) {
+      if (program->stream_index[i] == index) {
+        e = av_dict_get(program->metadata, "variant_bitrate", nullptr, 0);
+        break;
+      }
+    }
+  }
+  return e && e->value ? strtoll(e->value, nullptr, 10) : 0;
+}
+} // namespace
+
+void VariantSelector::init(AVFormatContext *fmtCtx) {
+  m_variants.clear();
+  m_stream = -1;
+  m_samples = 0;
+  m_blockedBitrate = 0;
+  if (fmtCtx->iformat && strstr(fmtCtx->iformat->name, "hls")) {
+    for (unsigned i = 0; i < fmtCtx->nb_streams; i++) {
+      AVCodecParameters *par = fmtCtx->streams[i]->codecpar;
+      if (par->codec_type != AVMEDIA_TYPE_VIDEO)
+        continue;
+      Variant v;
+      v.stream = int(i);
+      v.bitrate = variant_bitrate(fmtCtx, i);
+      v.width = par->width;
+      v.height = par->height;
+      if (v.bitrate > 0)
+        m_variants.push_back(v);
+    }
+  }
+  std::sort(m_variants.begin(), m_variants.end(),
+            [](const Variant &a, const Variant &b) { return a.bitrate < b.bitrate; });
+  m_active = m_variants.size() >= 2;
+  if (m_active) {
+    for (const Variant &v : m_variants)
+      qCDebug(lcPlayer) << "HLS variant: stream" << v.stream << v.width << "x"
+                        << v.height << v.bitrate / 1000 << "kbps";
+  }
+}
+
+const VariantSelector::Variant *VariantSelector::find(int stream) const {
+  for (const Variant &v : m_variants)
+    if (v.stream == stream)
+      return &v;
+  return nullptr;
+}
+
+int VariantSelector::lowest() const {
+  return m_variants.empty() ? -1 : m_variants.front().stream;
+}
+
+void VariantSelector::switched(int stream) {
+  m_stream = stream;
+  m_load = 0;
+  m_samples = 0;
+  m_since = clock::now();
+}
+
+void VariantSelector::report(double costMs, int frameIntervalMs) {
+  if (!m_active || frameIntervalMs <= 0)
+    return;
+  double load = costMs / frameIntervalMs;
+  m_load = m_samples ? m_load * 0.9 + load * 0.1 : load;
+  m_samples++;
+}
+
+double VariantSelector::predictedLoad(const Variant &from,
+                                      const Variant &to) const {
+  // 解码耗时大致与像素数成正比；尺寸未知时按码率估算
+  double a = double(from.width) * from.height;
+  double b = double(to.width) * to.height;
+  if (a <= 0 || b <= 0) {
+    a = double(from.bitrate);
+    b = double(to.bitrate);
+  }
+  return m_load * b / a;
+}
+
+int VariantSelector::choose(int current, bool degraded, qint64 throughput) {
+  const Variant *cur = find(current);
+  if (!m_active || !cur || current != m_stream || m_samples < MIN_SAMPLES)
+    return current;
+  auto now = clock::now();
+  bool netLimited = throughput > 0 && cur->bitrate > throughput * NET_MARGIN;
+  auto fits = [&](const Variant &v) {
+    return predictedLoad(*cur, v) <= TARGET_LOAD &&
+           (throughput <= 0 || v.bitrate <= throughput * NET_MARGIN);
+  };
+
+  if (degraded || m_load > DOWN_LOAD || netLimited) {
+    // 降到仍有余量的最高一档，都不满足时用最低档
+    int pick = m_variants.front().stream;
+    for (const Variant &v : m_variants)
+      if (v.bitrate < cur->bitrate && fits(v))
+        pick = v.stream;
+    if (pick != current) {
+      if (!netLimited) {
+        m_blockedBitrate = cur->bitrate;
+        m_blockedUntil = now + std::chrono::milliseconds(BLOCK_MS);
+      }
+      qCDebug(lcPlayer) << "HLS variant down: load" << m_load << "degraded"
+                        << degraded << "throughput" << throughput / 1000
+                        << "kbps";
+    }
+    return pick;
+  }
+
+  if (now - m_since < std::chrono::milliseconds(UP_HOLD_MS))
+    return current;
+  if (m_blockedBitrate && now >= m_blockedUntil)
+    m_blockedBitrate = 0;
+  int pick = current;
+  for (const Variant &v : m_variants)
+    if (v.bitrate > cur->bitrate &&
+        (!m_blockedBitrate || v.bitrate < m_blockedBitrate) && fits(v))
+      pick = v.stream;
+  if (pick != current)
+    qCDebug(lcPlayer) << "HLS variant up: load" << m_load << "throughput"
+                      << throughput / 1000 << "kbps";
+  return pick;
+}
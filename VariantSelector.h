@@ -0,0 +1,58 @@
+#pragma once
+#include "FFmpegUtils.h"
+#include <QtGlobal>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+// HLS 多码率变体的自适应选择
+// 我们的硬件上瓶颈是解码而不是网络，只按带宽挑最高码率会让解码跟不上。
+// 以视频线程实测的每帧解码耗时与帧间隔之比作为当前变体的 CPU 负载，
+// 按像素数推算其他变体的负载，再用下载速率限制码率，选出负载仍有余量的
+// 最高变体。负载过高或解码已被降级时立即降档；升档要在当前变体上稳定一段时间，
+// 刚因负载过高退下来的码率在一段时间内不再尝试。
+class VariantSelector {
+public:
+  struct Variant {
+    int stream = -1;
+    qint64 bitrate = 0; // 主播放列表声明的带宽，bit/s
+    int width = 0;
+    int height = 0;
+  };
+
+  // 从 HLS 输入收集视频变体（按码率升序），不足两个时不启用
+  void init(AVFormatContext *fmtCtx);
+  bool active() const { return m_active; }
+  const Variant *find(int stream) const;
+  int lowest() const;
+
+  // 开始解码某个变体，之前的统计作废
+  void switched(int stream);
+  // 记录一帧的解码耗时（ms）
+  void report(double costMs, int frameIntervalMs);
+
+  // 建议解码的变体，与 current 相同表示保持。degraded 表示解码质量已被降级，
+  // throughput 为下载速率（bit/s，0 表示未知）
+  int choose(int current, bool degraded, qint64 throughput);
+
+private:
+  using clock = std::chrono::steady_clock;
+
+  static const int MIN_SAMPLES = 48;         // 做出判断前至少统计的帧数
+  static const int UP_HOLD_MS = 10000;       // 升档前在当前变体上的稳定时间
+  static const int BLOCK_MS = 60000;         // 因负载降档后不再尝试原码率的时间
+  static constexpr double DOWN_LOAD = 0.85;  // 负载超过它立即降档
+  static constexpr double TARGET_LOAD = 0.6; // 选择的变体推算负载不超过它
+  static constexpr double NET_MARGIN = 0.8;  // 码率不超过下载速率的比例
+
+  double predictedLoad(const Variant &from, const Variant &to) const;
+
+  std::atomic<bool> m_active{false};
+  std::vector<Variant> m_variants;
+  int m_stream = -1;
+  double m_load = 0; // 当前变体的负载，指数平滑
+  int m_samples = 0;
+  clock::time_point m_since;
+  qint64 m_blockedBitrate = 0; // 不低于它的码率暂不升档，0 表示无限制
+  clock::time_point m_blockedUntil;
+};
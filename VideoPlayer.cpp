@@ -17,6 +17,7 @@
 #include <QPainterPath>
 #include <QProcess>
 #include <QPushButton>
+#include <QScreen>
 #include <QSharedPointer>
 #include <QStandardPaths>
 #include <QTextStream>
@@ -31,10 +32,20 @@
 #include <taglib/unsynchronizedlyricsframe.h>
 #include <taglib/xiphcomment.h>
 
+bool VideoPlayer::s_compositorEnabled = false;
+
+namespace {
+QString formatTime(qint64 ms) {
+  qint64 sec = ms / 1000;
+  return QString("%1:%2").arg(sec / 60).arg(sec % 60, 2, 10, QChar('0'));
+}
+} // namespace
+
 VideoPlayer::VideoPlayer(QWidget *parent)
-    : QWidget(parent), lastScrollUpdateTime(0), updatePending(false),
-      lastUpdateTime(0) {
+    : QWidget(parent), lastScrollUpdateTime(0), lastUpdateTime(0) {
   setAttribute(Qt::WA_AcceptTouchEvents);
+  // paintEvent 自己填充整个重绘区域，不需要 Qt 先擦除背景
+  setAttribute(Qt::WA_OpaquePaintEvent);
   setWindowFlags(Qt::FramelessWindowHint);
 
   // AudioOutput
@@ -53,36 +64,38 @@ VideoPlayer::VideoPlayer(QWidget *parent)
   // Decoder
   decoder = new FFMpegDecoder(this);
   connect(decoder, &FFMpegDecoder::frameReady, this, &VideoPlayer::onFrame);
+  connect(decoder, &FFMpegDecoder::frameAvailable, this,
+          [this]() { scheduleUpdate(DamageFrame); });
   connect(decoder, &FFMpegDecoder::audioReady, this, &VideoPlayer::onAudioData);
-  connect(decoder, &FFMpegDecoder::durationChanged, this,
-          [&](qint64 d) { duration = d; });
-  connect(decoder, &FFMpegDecoder::positionChanged, this,
-          &VideoPlayer::onPositionChanged);
+  // 位置、时长、错误等状态收到通知时读取快照，按变化的部分安排重绘
+  connect(decoder, &FFMpegDecoder::stateChanged, this,
+          &VideoPlayer::applyDecoderState);
 
   // 错误提示
   errorShowTimer = new QTimer(this);
   errorShowTimer->setSingleShot(true);
   connect(errorShowTimer, &QTimer::timeout, this, [this]() {
     errorMessage.clear();
-    scheduleUpdate();
+    scheduleUpdate(DamageCenter);
   });
-  connect(decoder, &FFMpegDecoder::errorOccurred, this,
-          [this](const QString &msg) {
-            errorMessage = msg;
-            errorShowTimer->start(3000); // 显示 3 秒
-            scheduleUpdate();
-          });
 
   // 顶部土司消息
   toastTimer = new QTimer(this);
-  toastTimer->setInterval(16); // 每帧刷新 (~60 FPS)
+  toastTimer->setInterval(16); // 淡入淡出时每帧刷新 (~60 FPS)
   connect(toastTimer, &QTimer::timeout, this, [this]() {
-    toastElapsedMs += 16;
+    toastElapsedMs = int(toastClock.elapsed());
+    int fadeOutAt = toastTotalDuration - toastFadeDuration;
     if (toastElapsedMs >= toastTotalDuration) {
       toastTimer->stop();
       toastMessage.clear();
+    } else if (toastElapsedMs >= toastFadeDuration &&
+               toastElapsedMs < fadeOutAt) {
+      // 停留阶段画面不变，直接等到淡出开始
+      toastTimer->setInterval(fadeOutAt - toastElapsedMs);
+    } else {
+      toastTimer->setInterval(16);
     }
-    scheduleUpdate();
+    scheduleUpdate(DamageToast);
   });
 
   // 初始化长按 2 倍速播放定时器
@@ -99,45 +112,33 @@ VideoPlayer::VideoPlayer(QWidget *parent)
     }
   });
 
-  // Overlay 更新
-  overlayTimer = new QTimer(this);
-  overlayTimer->setInterval(200);
-  connect(overlayTimer, &QTimer::timeout, this, &VideoPlayer::updateOverlay);
-
   // 进度条显示定时器
   overlayBarTimer = new QTimer(this);
   overlayBarTimer->setSingleShot(true);
   connect(overlayBarTimer, &QTimer::timeout, this, [this]() {
     showOverlayBar = false;
     updateOverlayVisibility();
-    scheduleUpdate();
+    scheduleUpdate(DamageProgress);
   });
   showOverlayBar = false;
 
-  // 帧率控制定时器 - 60fps (约 16.67 ms)
-  frameRateTimer = new QTimer(this);
-  frameRateTimer->setInterval(16); // ~60fps
-  connect(frameRateTimer, &QTimer::timeout, this, [this]() {
-    if (updatePending) {
-      updatePending = false;
-      QWidget::update();
-    }
+  // 拖动预览的 seek 节流：两次 seek 之间至少间隔 SCRUB_SEEK_INTERVAL_MS，
+  // 期间的鼠标移动只更新目标位置，到时再发出最新的一个
+  scrubSeekTimer = new QTimer(this);
+  scrubSeekTimer->setSingleShot(true);
+  connect(scrubSeekTimer, &QTimer::timeout, this, [this]() {
+    if (!isSeeking || !scrubSeekPending)
+      return;
+    scrubSeekPending = false;
+    decoder->seek(currentPts);
+    scrubSeekTimer->start(SCRUB_SEEK_INTERVAL_MS);
   });
 
-  // 启动定时器 - 集中启动以提高代码清晰度
-  frameRateTimer->start();
-
-  // 重置状态变量
-  updatePending = false;
-
-  // libass 初始化
-  assLibrary = ass_library_init();
-  if (assLibrary) {
-    assRenderer = ass_renderer_init(assLibrary);
-    if (assRenderer) {
-      ass_set_fonts(assRenderer, nullptr, "Microsoft YaHei", 1, nullptr, 1);
-    }
-  }
+  // 帧率控制定时器 - 60fps (约 16.67 ms)
+  // 单次触发，只在有被推迟的刷新时启动，画面静止时没有任何定时唤醒
+  frameRateTimer = new QTimer(this);
+  frameRateTimer->setSingleShot(true);
+  connect(frameRateTimer, &QTimer::timeout, this, &VideoPlayer::flushUpdate);
 
   // 屏幕状态文件监听
   screenStatusWatcher = new QFileSystemWatcher(this);
@@ -158,8 +159,29 @@ VideoPlayer::VideoPlayer(QWidget *parent)
 
   lyricManager = new LyricManager();
   subtitleManager = new SubtitleManager();
-  lyricRenderer = new LyricRenderer(lyricManager);
-  subtitleRenderer = new SubtitleRenderer(subtitleManager);
+  lyricRenderer = new LyricRenderer(lyricManager, &cueCache);
+  subtitleRenderer = new SubtitleRenderer(subtitleManager, &cueCache);
+  // ASS 预渲染补上了未命中的帧：回到界面线程重绘字幕
+  subtitleRenderer->setPrerenderReadyCallback([this]() {
+    QMetaObject::invokeMethod(
+        this, [this]() { scheduleUpdate(DamageSubtitle); },
+        Qt::QueuedConnection);
+  });
+  overlayPainter =
+      new OverlayPainter(subtitleManager, subtitleRenderer, lyricRenderer);
+  overlayPainter->setAssEngine(&assEngine);
+  // libass 在后台初始化完成：此前的 ASS 字幕没有画出来，回到界面线程重绘
+  assEngine.setReadyCallback([this]() {
+    QMetaObject::invokeMethod(
+        this, [this]() { scheduleUpdate(DamageSubtitle); },
+        Qt::QueuedConnection);
+  });
+  if (s_compositorEnabled) {
+    compositor = new OverlayCompositor(decoder, overlayPainter, this);
+    connect(compositor, &OverlayCompositor::composed, this,
+            &VideoPlayer::onComposed);
+    compositor->start();
+  }
 
   // 轨道切换按钮和菜单
   trackButton = new QPushButton(this);
@@ -176,58 +198,16 @@ VideoPlayer::VideoPlayer(QWidget *parent)
                              "}");
   trackButton->setToolTip("轨道切换");
   trackButton->raise();
+  trackMenu = new QMenu(this);
+  trackAudioGroup = new QActionGroup(this);
+  trackAudioGroup->setExclusive(true);
+  trackVideoGroup = new QActionGroup(this);
+  trackVideoGroup->setExclusive(true);
   connect(trackButton, &QPushButton::clicked, this, [this]() {
-    QMenu menu;
-    QActionGroup *audioGroup = new QActionGroup(&menu);
-    audioGroup->setExclusive(true);
-    int acnt = decoder->audioTrackCount();
-    for (int i = 0; i < acnt; ++i) {
-      QAction *act = menu.addAction(decoder->audioTrackName(i));
-      act->setCheckable(true);
-      act->setChecked(decoder->currentAudioTrack() == i);
-      audioGroup->addAction(act);
-      connect(act, &QAction::triggered, this, [this, i]() {
-        decoder->setAudioTrack(i);
-        showToastMessage(tr("音轨: %1").arg(decoder->audioTrackName(i)));
-        scheduleUpdate();
-      });
-    }
-    // QAction *muteAct = menu.addAction(tr("静音轨道"));
-    // muteAct->setCheckable(true);
-    // muteAct->setChecked(decoder->currentAudioTrack() == -1);
-    // audioGroup->addAction(muteAct);
-    // connect(muteAct, &QAction::triggered, this, [this]() {
-    //   decoder->setAudioTrack(-1);
-    //   errorMessage = tr("切换音轨: 静音轨道");
-    //   errorShowTimer->start(2000);
-    //   scheduleUpdate();
-    // });
-    menu.addSeparator();
-    QActionGroup *videoGroup = new QActionGroup(&menu);
-    videoGroup->setExclusive(true);
-    int vcnt = decoder->videoTrackCount();
-    for (int i = 0; i < vcnt; ++i) {
-      QAction *act = menu.addAction(decoder->videoTrackName(i));
-      act->setCheckable(true);
-      act->setChecked(decoder->currentVideoTrack() == i);
-      videoGroup->addAction(act);
-      connect(act, &QAction::triggered, this, [this, i]() {
-        decoder->setVideoTrack(i);
-        showToastMessage(
-            tr("切换视频轨道: %1").arg(decoder->videoTrackName(i)));
-        scheduleUpdate();
-      });
-    }
-    QAction *noVideoAct = menu.addAction(tr("无视频轨道"));
-    noVideoAct->setCheckable(true);
-    noVideoAct->setChecked(decoder->currentVideoTrack() == -1);
-    videoGroup->addAction(noVideoAct);
-    connect(noVideoAct, &QAction::triggered, this, [this]() {
-      decoder->setVideoTrack(-1);
-      showToastMessage("视频轨道: 无");
-      scheduleUpdate();
-    });
-    menu.exec(trackButton->mapToGlobal(QPoint(0, trackButton->height())));
+    // 用户可能切换轨道，在后台补全未探测的流；补全后菜单按新的轨道名重建
+    decoder->probeAllStreams();
+    populateTrackMenu();
+    trackMenu->exec(trackButton->mapToGlobal(QPoint(0, trackButton->height())));
   });
 
   // 字幕开关按钮
@@ -251,7 +231,43 @@ VideoPlayer::VideoPlayer(QWidget *parent)
                                       ? ":/icons/subtitles.png"
                                       : ":/icons/subtitles_off.png"));
     showToastMessage(subtitlesEnabled ? "字幕已开启" : "字幕已关闭");
-    scheduleUpdate();
+    scheduleUpdate(DamageSubtitle);
+  });
+
+  // A-B 循环按钮
+  loopButton = new QPushButton(this);
+  loopButton->setGeometry(94, 10, 32, 32);
+  loopButton->setText("AB");
+  loopButton->setStyleSheet("QPushButton {"
+                            "  background-color: rgba(30,30,30,180);"
+                            "  color: white;"
+                            "  border: none;"
+                            "  border-radius: 16px;"
+                            "}"
+                            "QPushButton:hover {"
+                            "  background-color: rgba(50,50,50,200);"
+                            "}");
+  loopButton->setToolTip("A-B 循环");
+  loopButton->raise();
+  connect(loopButton, &QPushButton::clicked, this, [this]() {
+    if (loopEndMs >= 0) {
+      decoder->clearLoopRegion();
+      loopStartMs = loopEndMs = -1;
+      showToastMessage("已取消 A-B 循环");
+    } else if (loopStartMs < 0) {
+      loopStartMs = currentPts;
+      showToastMessage(QString("A 点: %1").arg(formatTime(loopStartMs)));
+    } else if (currentPts > loopStartMs + 500) {
+      loopEndMs = currentPts;
+      decoder->setLoopRegion(loopStartMs, loopEndMs);
+      showToastMessage(QString("A-B 循环: %1 - %2")
+                           .arg(formatTime(loopStartMs))
+                           .arg(formatTime(loopEndMs)));
+    } else {
+      loopStartMs = -1;
+      showToastMessage("B 点需在 A 点之后");
+    }
+    scheduleUpdate(DamageProgress);
   });
 }
 
@@ -261,32 +277,36 @@ VideoPlayer::~VideoPlayer() {
     frameRateTimer->stop();
   if (speedPressTimer)
     speedPressTimer->stop();
+  if (scrubSeekTimer)
+    scrubSeekTimer->stop();
   if (toastTimer)
     toastTimer->stop();
   if (errorShowTimer)
     errorShowTimer->stop();
-  if (overlayTimer)
-    overlayTimer->stop();
   if (overlayBarTimer)
     overlayBarTimer->stop();
 
+  // 合成线程使用解码器和字幕渲染器，最先停止
+  if (compositor)
+    compositor->stop();
+
   // 停止解码器和音频输出
   if (decoder)
     decoder->stop();
   if (audioOutput)
     audioOutput->stop();
 
-  // libass 资源释放 - 先释放渲染器，再释放库
-  if (assRenderer) {
-    ass_renderer_done(assRenderer);
-    assRenderer = nullptr;
-  }
-  if (assLibrary) {
-    ass_library_done(assLibrary);
-    assLibrary = nullptr;
-  }
+  // libass 资源释放 - 先停止预渲染线程，再释放渲染器和库
+  if (subtitleRenderer)
+    subtitleRenderer->stopPrerender();
+  assEngine.release();
+
+  // 预渲染线程使用字幕文字，在释放渲染器前停止
+  cueCache.stop();
 
   // 释放对象资源 - 使用 nullptr 检查增加安全性
+  delete overlayPainter;
+  overlayPainter = nullptr;
   delete lyricRenderer;
   lyricRenderer = nullptr;
   delete subtitleRenderer;
@@ -297,17 +317,35 @@ VideoPlayer::~VideoPlayer() {
   subtitleManager = nullptr;
 }
 
+void VideoPlayer::setCompositorEnabled(bool enabled) {
+  s_compositorEnabled = enabled;
+}
+
 void VideoPlayer::play(const QString &path) {
   // 启动音频输出
   QProcess::execute("ubus", QStringList()
                                 << "call" << "eq_drc_process.output.rpc"
                                 << "control" << R"({"action":"Open"})");
 
+  // 合成线程会读取字幕，加载期间先停下
+  if (compositor)
+    compositor->stop();
+  cueCache.clear();
+  subtitleRenderer->stopPrerender();
   lyricManager->loadLyrics(path);
   subtitleManager->reset();
+  loopStartMs = loopEndMs = -1;
 
-  subtitleManager->loadSubtitle(path, assLibrary, assRenderer);
+  subtitleManager->loadSubtitle(path, &assEngine);
+  if (compositor)
+    compositor->start();
 
+  if (QScreen *s = screen()) {
+    decoder->setDisplayRefreshRate(s->refreshRate());
+    // 窗口尚未显示时按全屏尺寸估计，显示后由 resizeEvent 更新
+    if (!isVisible())
+      decoder->setDisplaySize(s->size().width(), s->size().height());
+  }
   decoder->start(path);
   show();
   showOverlayBar = true;
@@ -316,27 +354,146 @@ void VideoPlayer::play(const QString &path) {
   scheduleUpdate();
 }
 
+// 按最近一次读到的解码器状态填充轨道菜单；菜单打开期间轨道名变化时重新填充
+void VideoPlayer::populateTrackMenu() {
+  trackMenu->clear();
+  const QStringList audioTracks = decoderState.audioTracks;
+  for (int i = 0; i < audioTracks.size(); ++i) {
+    QAction *act = trackMenu->addAction(audioTracks[i]);
+    act->setCheckable(true);
+    act->setChecked(decoder->currentAudioTrack() == i);
+    trackAudioGroup->addAction(act);
+    connect(act, &QAction::triggered, this, [this, i, audioTracks]() {
+      decoder->setAudioTrack(i);
+      showToastMessage(tr("音轨: %1").arg(audioTracks[i]));
+    });
+  }
+  // QAction *muteAct = trackMenu->addAction(tr("静音轨道"));
+  // muteAct->setCheckable(true);
+  // muteAct->setChecked(decoder->currentAudioTrack() == -1);
+  // trackAudioGroup->addAction(muteAct);
+  // connect(muteAct, &QAction::triggered, this, [this]() {
+  //   decoder->setAudioTrack(-1);
+  //   errorMessage = tr("切换音轨: 静音轨道");
+  //   errorShowTimer->start(2000);
+  //   scheduleUpdate();
+  // });
+  trackMenu->addSeparator();
+  // HLS 多码率：自动选择变体，选中具体轨道即改为固定
+  bool autoVariant = decoder->hasVariants() && decoder->variantAuto();
+  if (decoder->hasVariants()) {
+    QAction *autoAct = trackMenu->addAction(tr("自动（按解码能力）"));
+    autoAct->setCheckable(true);
+    autoAct->setChecked(autoVariant);
+    trackVideoGroup->addAction(autoAct);
+    connect(autoAct, &QAction::triggered, this, [this]() {
+      decoder->setVariantAuto(true);
+      showToastMessage(tr("视频轨道: 自动"));
+    });
+  }
+  const QStringList videoTracks = decoderState.videoTracks;
+  for (int i = 0; i < videoTracks.size(); ++i) {
+    QAction *act = trackMenu->addAction(videoTracks[i]);
+    act->setCheckable(true);
+    act->setChecked(!autoVariant && decoder->currentVideoTrack() == i);
+    trackVideoGroup->addAction(act);
+    connect(act, &QAction::triggered, this, [this, i, videoTracks]() {
+      decoder->setVideoTrack(i);
+      showToastMessage(tr("切换视频轨道: %1").arg(videoTracks[i]));
+    });
+  }
+  QAction *noVideoAct = trackMenu->addAction(tr("无视频轨道"));
+  noVideoAct->setCheckable(true);
+  noVideoAct->setChecked(decoder->currentVideoTrack() == -1);
+  trackVideoGroup->addAction(noVideoAct);
+  connect(noVideoAct, &QAction::triggered, this, [this]() {
+    decoder->setVideoTrack(-1);
+    showToastMessage("视频轨道: 无");
+  });
+}
+
 void VideoPlayer::onFrame(const QSharedPointer<QImage> &frame) {
   currentFrame = frame;
-  scheduleUpdate();
+  ++frameSerial;
+  scheduleUpdate(DamageFrame);
 }
 
 void VideoPlayer::onAudioData(const QByteArray &data) { audioIO->write(data); }
 
-void VideoPlayer::onPositionChanged(qint64 pts) {
-  // 拖动 seeking 时不更新进度条进度
-  if (isSeeking) {
+void VideoPlayer::applyDecoderState() {
+  quint64 errorVersion = decoderState.errorVersion;
+  quint64 tracksVersion = decoderState.tracksVersion;
+  qint64 lastPosition = decoderState.positionMs;
+  decoder->readState(decoderState);
+  // 后台探测补全了轨道信息：正在显示的轨道菜单换成新的轨道名
+  if (decoderState.tracksVersion != tracksVersion && trackMenu->isVisible())
+    populateTrackMenu();
+  if (duration != decoderState.durationMs) {
+    duration = decoderState.durationMs;
+    scheduleUpdate(DamageProgress);
+  }
+
+  // 新的错误消息
+  if (decoderState.errorVersion != errorVersion &&
+      !decoderState.error.isEmpty()) {
+    errorMessage = decoderState.error;
+    errorShowTimer->start(3000); // 显示 3 秒
+    scheduleUpdate(DamageCenter);
+  }
+
+  // 拖动 seeking 时不更新进度条进度；位置没变时保留界面上的值
+  if (isSeeking || decoderState.positionMs == lastPosition) {
     return;
   }
 
   // 更新当前播放时间
+  qint64 pts = decoderState.positionMs;
   currentPts = pts;
 
-  // 更新歌词和字幕索引
-  subtitleManager->updateSubtitleIndex(pts);
+  // 字幕索引在绘制字幕时按位置更新；只在显示内容变化时重画字幕区域
+  int damage = 0;
+  if (subtitleChanged(pts))
+    damage |= DamageSubtitle;
+  if (showOverlayBar)
+    damage |= DamageProgress;
+  scheduleUpdate(damage);
+}
 
-  // 更新界面
-  scheduleUpdate();
+// 字幕和歌词在 pts 时刻的显示是否与上次不同：换了条目、处在淡入淡出中，
+// 或 ASS 预渲染的图像变了。没有字幕和歌词时不重画字幕区域
+bool VideoPlayer::subtitleChanged(qint64 pts) {
+  qint64 subtitleStart = -1, subtitleEnd = -1;
+  qint64 lyricStart = -1, lyricEnd = -1;
+  if (subtitlesEnabled) {
+    // 只读查找，字幕索引仍由绘制（可能在合成线程）更新
+    for (const SubtitleLine &line : subtitleManager->getSubtitles()) {
+      if (pts >= line.startTime && pts <= line.endTime) {
+        subtitleStart = line.startTime;
+        subtitleEnd = line.endTime;
+        break;
+      }
+    }
+    LyricLine lyric = lyricManager->getCurrentLyric(pts);
+    if (!lyric.text.isEmpty() && pts >= lyric.time && pts < lyric.endTime) {
+      lyricStart = lyric.time;
+      lyricEnd = lyric.endTime;
+    }
+  }
+  auto fading = [pts](qint64 start, qint64 end) {
+    return start >= 0 && (pts < start + CUE_FADE_MS || pts > end - CUE_FADE_MS);
+  };
+  bool changed = subtitleStart != shownSubtitleStart ||
+                 lyricStart != shownLyricStart ||
+                 fading(subtitleStart, subtitleEnd) ||
+                 fading(lyricStart, lyricEnd);
+  shownSubtitleStart = subtitleStart;
+  shownLyricStart = lyricStart;
+
+  // libass 初始化完成前不显示 ASS 字幕，完成时另行请求重画
+  if (subtitleManager->hasAss() && assEngine.renderer() &&
+      subtitleRenderer->assChangedAt(pts))
+    changed = true;
+  return changed;
 }
 
 void VideoPlayer::mousePressEvent(QMouseEvent *e) {
@@ -367,14 +524,21 @@ void VideoPlayer::mouseReleaseEvent(QMouseEvent *) {
 
   if (isSeeking) {
     isSeeking = false;
+    // 松手位置直接 seek，丢弃节流中尚未发出的目标
+    scrubSeekTimer->stop();
+    scrubSeekPending = false;
     // seek 前检查 duration 是否有效
     if (duration > 0 && currentPts >= 0 && currentPts <= duration) {
       decoder->seek(currentPts);
     }
+    decoder->endScrub();
+    // 拖出 A-B 区间时解码器会取消循环
+    if (loopEndMs >= 0 && !decoder->hasLoopRegion())
+      loopStartMs = loopEndMs = -1;
     showOverlayBar = true;
     overlayBarTimer->start(5 * 1000);
     updateOverlayVisibility();
-    scheduleUpdate();
+    scheduleUpdate(DamageProgress);
   } else {
     decoder->togglePause();
     // 根据暂停状态调整控件可见性
@@ -389,6 +553,7 @@ void VideoPlayer::mouseReleaseEvent(QMouseEvent *) {
       overlayBarTimer->start(5 * 1000);
       updateOverlayVisibility();
     }
+    scheduleUpdate(DamageProgress);
   }
 }
 
@@ -398,14 +563,28 @@ void VideoPlayer::mouseDoubleClickEvent(QMouseEvent *) { close(); }
 void VideoPlayer::mouseMoveEvent(QMouseEvent *e) {
   if (!pressed || e == nullptr)
     return;
+  // 长按倍速期间不进入拖动预览：松手只恢复速度，不会结束拖动
+  if (isSpeedPressed)
+    return;
 
   int dx = e->pos().x() - pressPos.x();
+  if (!isSeeking) {
+    // 进入拖动预览：解码器只解关键帧并实时显示目标位置
+    decoder->beginScrub();
+  }
   isSeeking = true;
   seekByDelta(dx);
+  if (scrubSeekTimer->isActive()) {
+    scrubSeekPending = true;
+  } else {
+    decoder->seek(currentPts);
+    scrubSeekTimer->start(SCRUB_SEEK_INTERVAL_MS);
+  }
 
   overlayBarTimer->stop();
   showOverlayBar = true;
-  scheduleUpdate();
+  // 拖动预览时字幕跟随目标位置
+  scheduleUpdate(DamageSubtitle | DamageProgress);
 }
 
 void VideoPlayer::doScreenShot() {
@@ -433,6 +612,19 @@ void VideoPlayer::keyPressEvent(QKeyEvent *e) {
     doScreenShot();
   }
 
+  // 逐帧步进（, 上一帧 / . 下一帧）与倒放（R）
+  if (e->key() == Qt::Key_Comma || e->key() == Qt::Key_Period) {
+    decoder->stepFrame(e->key() == Qt::Key_Period ? 1 : -1);
+    overlayBarTimer->stop();
+    showOverlayBar = true;
+    updateOverlayVisibility();
+    scheduleUpdate(DamageProgress);
+  } else if (e->key() == Qt::Key_R && !(e->modifiers() & Qt::ControlModifier)) {
+    bool reverse = !decoder->isReversePlayback();
+    decoder->setReversePlayback(reverse);
+    showToastMessage(reverse ? "倒放" : "正常播放");
+  }
+
   QWidget::keyPressEvent(e);
 }
 
@@ -448,138 +640,71 @@ void VideoPlayer::seekByDelta(int dx) {
   currentPts = target;
 }
 
-void VideoPlayer::resizeEvent(QResizeEvent *) {}
+void VideoPlayer::resizeEvent(QResizeEvent *) {
+  decoder->setDisplaySize(width(), height());
+  // 合成图像按窗口尺寸重新生成
+  if (compositor)
+    scheduleUpdate();
+}
 
-void VideoPlayer::paintEvent(QPaintEvent *) {
-  // 绘制视频帧
+void VideoPlayer::paintEvent(QPaintEvent *e) {
+  // 只绘制需要更新的区域，与它不相交的部分直接跳过
+  const QRegion &dirty = e->region();
   QPainter p(this);
-  p.fillRect(rect(), Qt::black);
-  if (currentFrame && !currentFrame->isNull()) {
-    QSize imgSize = currentFrame->size();
-    QSize widgetSize = size();
-    imgSize.scale(widgetSize, Qt::KeepAspectRatio);
-    QRect targetRect(QPoint(0, 0), imgSize);
-    targetRect.moveCenter(rect().center());
-    p.drawImage(targetRect, *currentFrame);
-  }
 
-  // 绘制字幕和歌词
-  drawSubtitlesAndLyrics(p);
-  if (subtitleManager->hasAss() && subtitleManager->getAssTrack() &&
-      assRenderer) {
-    subtitleRenderer->setAssRenderer(assRenderer);
-    subtitleRenderer->drawAssSubtitles(p, width(), height(), currentPts);
+  // 合成线程已画好整张图像，这里只贴图
+  if (compositor) {
+    std::shared_ptr<const QImage> img = compositor->result();
+    for (const QRect &r : dirty) {
+      if (img && img->rect().contains(r))
+        p.drawImage(r, *img, r);
+      else
+        p.fillRect(r, Qt::black);
+    }
+    return;
   }
 
-  // 绘制顶部土司消息
-  drawToastMessage(p);
-
-  // 绘制错误消息
-  if (!errorMessage.isEmpty()) {
-    // 使用静态字体对象，避免频繁创建
-    static QFont errFont("Microsoft YaHei", 0, QFont::Bold);
-    errFont.setPointSize(overlayFontSize + 4);
-
-    QString msg = errorMessage;
-
-    // 保存当前绘图状态
-    p.save();
-
-    p.setFont(errFont);
-    QFontMetrics fm(errFont);
-    int textWidth = fm.horizontalAdvance(msg);
-    int textHeight = fm.height();
-    QRect boxRect((width() - textWidth) / 2 - 30,
-                  (height() - textHeight) / 2 - 16, textWidth + 60,
-                  textHeight + 32);
-    p.setRenderHint(QPainter::Antialiasing, true);
-    p.setPen(Qt::NoPen);
-    p.setBrush(QColor(0, 0, 0, 180));
-    p.drawRoundedRect(boxRect, 18, 18);
-    p.setPen(QColor(220, 40, 40));
-    p.drawText(boxRect, Qt::AlignCenter, msg);
-
-    // 恢复绘图状态
-    p.restore();
+  // 取信箱中最新的解码帧，只转换真正显示的这一帧
+  if (std::unique_ptr<FrameMailbox::Frame> f = decoder->takeFrame()) {
+    QSharedPointer<QImage> img = frameConverter.convert(
+        f->frame.get(), f->width, f->height, f->swsFlags);
+    if (img)
+      currentFrame = img;
   }
 
-  if (showOverlayBar) {
-    drawProgressBar(p);
+  // 视频帧位置变化（分辨率或窗口尺寸变化）时黑边也要重画
+  QRect targetRect;
+  if (currentFrame && !currentFrame->isNull())
+    targetRect = OverlayPainter::fitRect(currentFrame->size(), size());
+  if (targetRect != frameRect) {
+    frameRect = targetRect;
+    scheduleUpdate();
   }
-}
-
-void VideoPlayer::drawProgressBar(QPainter &p) {
-  double pct = (duration > 0) ? double(currentPts) / duration : 0.0;
-
-  // 样式参数
-  const int barHeight = 4;
-  const int radius = 2; // 圆角半径
-  const int marginX = 0;
-  const int barWidth = width() - marginX * 2;
-  const int barY = height() - barHeight;
-
-  QRectF fullBar(marginX, barY, barWidth, barHeight);
-  QRectF playedBar = fullBar;
-  playedBar.setWidth(fullBar.width() * pct);
-
-  p.setRenderHint(QPainter::Antialiasing, true);
 
-  // 背景轨道（浅灰色）
-  p.setBrush(QColor(80, 80, 80, 180)); // 半透明深灰
-  p.setPen(Qt::NoPen);
-  p.drawRoundedRect(fullBar, radius, radius);
+  // 绘制视频帧，黑色只填充帧以外的部分
+  for (const QRect &r : dirty.subtracted(QRegion(frameRect)))
+    p.fillRect(r, Qt::black);
+  if (!frameRect.isEmpty() && dirty.intersects(frameRect))
+    p.drawImage(frameRect, *currentFrame);
 
-  // 播放进度（红色）
-  if (playedBar.width() > 0.5) {
-    p.setBrush(QColor(255, 60, 60)); // 柔和红色
-    p.drawRoundedRect(playedBar, radius, radius);
-  }
-}
-
-void VideoPlayer::drawSubtitlesAndLyrics(QPainter &p) {
-  QRect lyricRect = rect().adjusted(0, height() - 70, 0, -10);
-  if (subtitlesEnabled) {
-    subtitleRenderer->drawSrtSubtitles(p, lyricRect, overlayFontSize,
-                                       currentPts);
-    lyricRenderer->drawLyricsByTime(p, lyricRect, overlayFontSize, currentPts);
-  }
+  // 绘制字幕、歌词、土司消息、错误消息和进度条
+  OverlayScene scene;
+  fillScene(scene);
+  overlayPainter->paint(p, scene, dirty);
 }
 
-void VideoPlayer::updateOverlay() { scheduleUpdate(); }
-
-void VideoPlayer::scheduleUpdate() {
-  // 只有在未标记待更新时才设置更新标记
-  if (!updatePending) {
-    // 获取当前时间戳
-    qint64 currentTime = QDateTime::currentMSecsSinceEpoch();
-
-    // 如果距离上次更新时间超过 16ms (约 60 fps)，立即更新界面
-    if (currentTime - lastUpdateTime > 16) {
-      lastUpdateTime = currentTime;
-      QWidget::update();
-    } else {
-      // 设置更新标记，由 frameRateTimer 定时处理
-      updatePending = true;
-    }
-  }
-}
+void VideoPlayer::fillScene(OverlayScene &scene) {
+  scene.size = size();
+  scene.frame = currentFrame;
+  scene.frameSerial = frameSerial;
+  scene.pts = currentPts;
+  scene.fontSize = overlayFontSize;
+  scene.subtitles = subtitlesEnabled;
 
-void VideoPlayer::showToastMessage(const QString &msg) {
-  toastMessage = msg;
-  toastElapsedMs = 0;
-  toastOpacity = 0.0;
-  toastSlideOffset = -30;
-  toastTimer->start();
-  update();
-}
-
-void VideoPlayer::drawToastMessage(QPainter &p) {
-  p.setRenderHint(QPainter::Antialiasing);
-
-  // ------- 自动 Toast -------
+  // 顶部土司消息：淡入、停留、淡出
   if (!toastMessage.isEmpty()) {
-    const int fadeDuration = 300;
-    const int displayDuration = 1500;
+    const int fadeDuration = toastFadeDuration;
+    const int displayDuration = toastTotalDuration - 2 * toastFadeDuration;
 
     if (toastElapsedMs < fadeDuration) {
       toastOpacity = toastElapsedMs / double(fadeDuration);
@@ -593,67 +718,132 @@ void VideoPlayer::drawToastMessage(QPainter &p) {
       toastOpacity = 1.0 - progress;
       toastSlideOffset = int(30 * progress);
     }
+    scene.toast = toastMessage;
+    scene.toastOpacity = toastOpacity;
+    scene.toastOffset = toastSlideOffset;
+  }
+
+  if (manualToastVisible) {
+    scene.manualToast = manualToastMessage;
+    scene.manualToastOpacity = manualToastOpacity;
+  }
+
+  scene.error = errorMessage;
+  scene.progress = showOverlayBar;
+  scene.duration = duration;
+  scene.loopStartMs = loopStartMs;
+  scene.loopEndMs = loopEndMs;
+}
 
-    static QFont toastFont("Microsoft YaHei", 0, QFont::Bold);
-    toastFont.setPointSize(overlayFontSize + 2);
-    p.setFont(toastFont);
-
-    QFontMetrics fm(toastFont);
-    int textWidth = fm.horizontalAdvance(toastMessage);
-    int textHeight = fm.height();
-    QRect toastRect((width() - textWidth) / 2 - 20, 20 + toastSlideOffset,
-                    textWidth + 40, textHeight + 16);
-
-    p.save();
-    p.setOpacity(toastOpacity);
-    p.setPen(Qt::NoPen);
-    p.setBrush(QColor(0, 0, 0, 200));
-    p.drawRoundedRect(toastRect, 12, 12);
-    p.setPen(Qt::white);
-    p.drawText(toastRect, Qt::AlignCenter, toastMessage);
-    p.restore();
+void VideoPlayer::onComposed(const QRect &rect, const QRegion &damage) {
+  // 只贴这张图像包含的更新；视频帧位置变化时黑边也要重画
+  QRegion region = damage;
+  if (rect != frameRect) {
+    frameRect = rect;
+    region = QRegion(this->rect());
   }
+  if (!region.isEmpty())
+    QWidget::update(region);
+}
+
+void VideoPlayer::scheduleUpdate(int damage) {
+  if (!damage)
+    return;
+  pendingDamage |= damage;
+  // 已推迟的刷新会一并处理
+  if (frameRateTimer->isActive())
+    return;
 
-  // ------- 手动 Toast -------
-  if (manualToastVisible && !manualToastMessage.isEmpty()) {
-    static QFont manualFont("Microsoft YaHei", 0, QFont::Bold);
-    manualFont.setPointSize(overlayFontSize);
-    p.setFont(manualFont);
-
-    QFontMetrics fm(manualFont);
-    int textWidth = fm.horizontalAdvance(manualToastMessage);
-    int textHeight = fm.height();
-    QRect toastRect((width() - textWidth) / 2 - 20,
-                    height() / 2 - textHeight / 2, // 居中显示
-                    textWidth + 20, textHeight + 8);
-
-    p.save();
-    p.setOpacity(manualToastOpacity); // 支持透明度动画
-    p.setPen(Qt::NoPen);
-    p.setBrush(QColor(20, 20, 20, 220));
-    p.drawRoundedRect(toastRect, 12, 12);
-    p.setPen(Qt::white);
-    p.drawText(toastRect, Qt::AlignCenter, manualToastMessage);
-    p.restore();
+  // 获取当前时间戳
+  qint64 currentTime = QDateTime::currentMSecsSinceEpoch();
+
+  // 如果距离上次更新时间超过 16ms (约 60 fps)，立即更新界面
+  qint64 wait = 16 - (currentTime - lastUpdateTime);
+  if (wait < 0) {
+    flushUpdate();
+  } else {
+    // 推迟到 16ms 间隔结束时由 frameRateTimer 处理
+    frameRateTimer->start(int(wait) + 1);
   }
 }
 
+void VideoPlayer::flushUpdate() {
+  QRegion region;
+  for (int part = DamageFrame; part < DamageAll; part <<= 1) {
+    if (pendingDamage & part)
+      region += damageRect(Damage(part));
+  }
+  pendingDamage = 0;
+  lastUpdateTime = QDateTime::currentMSecsSinceEpoch();
+  if (region.isEmpty())
+    return;
+
+  // 合成线程画好后再贴图
+  if (compositor) {
+    OverlayScene scene;
+    fillScene(scene);
+    compositor->submit(scene, region);
+    return;
+  }
+  QWidget::update(region);
+}
+
+QRect VideoPlayer::damageRect(Damage part) const {
+  switch (part) {
+  case DamageFrame:
+    // 还没有帧时整个画面都是黑底
+    return frameRect.isEmpty() ? rect() : frameRect;
+  case DamageSubtitle:
+    return OverlayPainter::subtitleBand(size(), subtitleManager->hasAss());
+  case DamageToast:
+    // 顶部土司消息包括上下滑动范围
+    if (!toastBandHeight)
+      toastBandHeight =
+          20 + 30 +
+          QFontMetrics(OverlayPainter::font(overlayFontSize + 2)).height() + 16;
+    return QRect(0, 0, width(), toastBandHeight);
+  case DamageCenter:
+    // 错误消息框比手动土司消息高，按它计算
+    if (!centerBandHeight)
+      centerBandHeight =
+          QFontMetrics(OverlayPainter::font(overlayFontSize + 4)).height() + 34;
+    return QRect(0, (height() - centerBandHeight) / 2, width(),
+                 centerBandHeight);
+  case DamageProgress:
+    return QRect(0, height() - 4, width(), 4);
+  default:
+    return rect();
+  }
+}
+
+void VideoPlayer::showToastMessage(const QString &msg) {
+  toastMessage = msg;
+  toastElapsedMs = 0;
+  toastOpacity = 0.0;
+  toastSlideOffset = -30;
+  toastClock.start();
+  toastTimer->start(16);
+  scheduleUpdate(DamageToast);
+}
+
 void VideoPlayer::showManualToast(const QString &msg) {
   manualToastMessage = msg;
   manualToastVisible = true;
   manualToastOpacity = 1.0; // 可选：初始时从0渐变
-  update();
+  scheduleUpdate(DamageCenter);
 }
 
 void VideoPlayer::clearManualToast() {
   manualToastMessage.clear();
   manualToastVisible = false;
-  update();
+  scheduleUpdate(DamageCenter);
 }
 
 void VideoPlayer::updateOverlayVisibility() {
   trackButton->setVisible(showOverlayBar);
   subtitleButton->setVisible(showOverlayBar);
+  loopButton->setVisible(showOverlayBar);
   trackButton->raise();
   subtitleButton->raise();
+  loopButton->raise();
 }
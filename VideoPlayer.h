@@ -1,5 +1,6 @@
 #pragma once
 #include <QAction>
+#include <QActionGroup>
 #include <QAudioOutput>
 #include <QElapsedTimer>
 #include <QFileSystemWatcher>
@@ -13,6 +14,8 @@
 
 #include "FFMpegDecoder.h"
 #include "LyricRenderer.h"
+#include "OverlayCompositor.h"
+#include "OverlayPainter.h"
 #include "SubtitleRenderer.h"
 
 class VideoPlayer : public QWidget {
@@ -22,6 +25,9 @@ public:
   ~VideoPlayer();
   void play(const QString &path);
 
+  // 叠加层改由合成线程绘制，需在创建窗口前设置
+  static void setCompositorEnabled(bool enabled);
+
 protected:
   // 手势/点击处理（双击关闭窗口）
   void mousePressEvent(QMouseEvent *e) override;
@@ -36,15 +42,13 @@ protected:
 private slots:
   void onFrame(const QSharedPointer<QImage> &frame);
   void onAudioData(const QByteArray &data);
-  void onPositionChanged(qint64 pts);
-  void updateOverlay();
+  void onComposed(const QRect &frameRect, const QRegion &damage);
 
 private:
   QAudioOutput *audioOutput;
   QIODevice *audioIO;
   FFMpegDecoder *decoder;
-  QTimer *overlayTimer;
-  QTimer *frameRateTimer; // 帧率控制定时器
+  QTimer *frameRateTimer; // 帧率控制定时器，只在有推迟的刷新时运行
 
   // 音频输出参数（补充声明）
   int audioSampleRate = 44100;
@@ -56,6 +60,9 @@ private:
   QPoint pressPos;
   // QElapsedTimer pressTimer;
   bool isSeeking = false;
+  QTimer *scrubSeekTimer = nullptr; // 拖动预览 seek 节流
+  bool scrubSeekPending = false;    // 节流期间有新的目标位置
+  static const int SCRUB_SEEK_INTERVAL_MS = 50;
   qint64 duration = 0;
   qint64 currentPts = 0;
 
@@ -66,25 +73,48 @@ private:
 
   LyricRenderer *lyricRenderer = nullptr;
   SubtitleRenderer *subtitleRenderer = nullptr;
+  TextCueCache cueCache; // 字幕、歌词文字的光栅化缓存
 
-  // libass 相关
-  ASS_Library *assLibrary = nullptr;
-  ASS_Renderer *assRenderer = nullptr;
+  // libass 相关：找到 ASS 字幕时才初始化
+  AssEngine assEngine;
 
   QSharedPointer<QImage> currentFrame;
+  DecoderState::Snapshot decoderState; // 最近一次读到的解码器状态
+  void applyDecoderState();
+  FrameConverter frameConverter; // 信箱取出的帧在绘制时转换
   // 进度条显示控制
   bool showOverlayBar = false;
   QTimer *overlayBarTimer = nullptr;
 
   // 统一 overlay 字号
   int overlayFontSize = 10;
+  mutable int toastBandHeight = 0; // 重绘区域高度，首次使用时按字体计算
+  mutable int centerBandHeight = 0;
+
+  // 叠加层绘制；开启合成线程时由合成线程使用
+  OverlayPainter *overlayPainter = nullptr;
+  OverlayCompositor *compositor = nullptr;
+  static bool s_compositorEnabled;
+  quint64 frameSerial = 0; // currentFrame 每换一次加一
+  void fillScene(OverlayScene &scene);
 
   void seekByDelta(int dx);
   void showOverlay(bool visible);
-  void drawProgressBar(QPainter &p);
-  void drawSubtitlesAndLyrics(QPainter &p);
   void updateOverlayVisibility();
-  void scheduleUpdate(); // 控制帧率的更新调度
+
+  // 重绘区域：各部分独立标记，只重绘变化的区域
+  enum Damage {
+    DamageFrame = 1,     // 视频帧
+    DamageSubtitle = 2,  // 底部字幕、歌词带（ASS 字幕为整个画面）
+    DamageToast = 4,     // 顶部土司消息带
+    DamageCenter = 8,    // 居中的错误消息和手动土司消息
+    DamageProgress = 16, // 底部进度条
+    DamageAll = 31
+  };
+  void scheduleUpdate(int damage = DamageAll); // 控制帧率的更新调度
+  void flushUpdate();
+  QRect damageRect(Damage part) const;
+  QRect frameRect; // 最近一次绘制的视频帧位置
 
   QFileSystemWatcher *screenStatusWatcher;
 
@@ -97,25 +127,30 @@ private:
 
   // 音轨/视频轨道切换按钮和菜单
   QPushButton *trackButton = nullptr;
+  QMenu *trackMenu = nullptr;
+  QActionGroup *trackAudioGroup = nullptr;
+  QActionGroup *trackVideoGroup = nullptr;
+  void populateTrackMenu();
   QElapsedTimer *trackButtonTimer;
   QMenu *audioMenu = nullptr;
   QMenu *videoMenu = nullptr;
 
   // 帧率控制
   qint64 lastScrollUpdateTime; // 上次滚动更新时间
-  bool updatePending = false;  // 是否有未处理的更新请求
   qint64 lastUpdateTime = 0;   // 上次更新时间
+  int pendingDamage = 0;       // 推迟到下一次刷新的区域
 
   // 顶部土司消息
   QString toastMessage;
   QTimer *toastTimer;
-  void drawToastMessage(QPainter &p);
   void showToastMessage(const QString &message);
 
+  QElapsedTimer toastClock;
   int toastElapsedMs = 0;
   qreal toastOpacity = 0.0;
   int toastSlideOffset = -30;
 
+  const int toastFadeDuration = 300;
   const int toastTotalDuration = 2100;
 
   // 手动管理的土司消息
@@ -129,6 +164,16 @@ private:
   // 字幕开关
   QPushButton *subtitleButton = nullptr;
   bool subtitlesEnabled = true;
+  // 上次播放位置下显示的字幕 / 歌词条目的开始时间，没有时为 -1
+  qint64 shownSubtitleStart = -1;
+  qint64 shownLyricStart = -1;
+  static const int CUE_FADE_MS = 400; // 字幕 300ms、歌词 400ms 淡入淡出，取长者
+  bool subtitleChanged(qint64 pts);
+
+  // A-B 循环：依次点击标记 A 点、B 点，再次点击取消
+  QPushButton *loopButton = nullptr;
+  qint64 loopStartMs = -1;
+  qint64 loopEndMs = -1;
 
   // 截屏
   void doScreenShot();
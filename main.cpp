@@ -1,6 +1,10 @@
 #include <QApplication>
 #include <QDebug>
 #include <QFileInfo>
+#include <cstring>
+#include "HttpCache.h"
+#include "MediaIO.h"
+#include "ProxyTranscoder.h"
 #include "VideoPlayer.h"
 #include "qapplication.h"
 
@@ -18,6 +22,28 @@ int main(int argc, char *argv[])
         QString arg = args.at(i);
         if (arg == "--help" || arg == "-h") {
             showHelp = true;
+        } else if (arg.startsWith("--readahead=")) {
+            // 预读窗口（MB）
+            int mb = arg.mid(int(strlen("--readahead="))).toInt();
+            if (mb > 0)
+                MediaIO::setReadaheadBytes(qint64(mb) * 1024 * 1024);
+        } else if (arg.startsWith("--io-latency=")) {
+            // 模拟慢速存储：每个预读块额外延迟（ms）
+            MediaIO::setInjectedLatency(arg.mid(int(strlen("--io-latency="))).toInt());
+        } else if (arg.startsWith("--net-startup=")) {
+            // 网络输入起播前缓冲量（KB）
+            HttpCache::setStartupBytes(
+                qint64(arg.mid(int(strlen("--net-startup="))).toInt()) * 1024);
+        } else if (arg.startsWith("--net-rebuffer=")) {
+            // 网络输入卡顿后重新缓冲量（KB）
+            HttpCache::setRebufferBytes(
+                qint64(arg.mid(int(strlen("--net-rebuffer="))).toInt()) * 1024);
+        } else if (arg == "--compositor") {
+            // 叠加层在独立线程合成，界面线程只贴图
+            VideoPlayer::setCompositorEnabled(true);
+        } else if (arg == "--proxy") {
+            // 代理模式：实时解码跟不上的视频在后台转码为代理文件
+            ProxyTranscoder::setEnabled(true);
         } else if (!arg.startsWith("-") && path.isEmpty()) {
             path = arg;
         }
@@ -25,18 +51,32 @@ int main(int argc, char *argv[])
 
     if (showHelp) {
         // qDebug() << "用法: NewPlayer <视频文件路径>";
-        qDebug() << "Usage: NewPlayer <video file path>";
+        qDebug() << "Usage: NewPlayer <video file path | http(s) URL>";
         // qDebug() << "参数:";
         qDebug() << "Options:";
         // qDebug() << "  --help, -h          显示帮助信息";
         qDebug() << "  --help, -h          Show help information";
+        // qDebug() << "  --readahead=<MB>    本地文件预读窗口（默认 8）";
+        qDebug() << "  --readahead=<MB>    Readahead window for local files (default 8)";
+        // qDebug() << "  --io-latency=<ms>   每读取 256 KB 注入的延迟（测试用）";
+        qDebug() << "  --io-latency=<ms>   Inject latency into each 256 KB read (testing)";
+        // qDebug() << "  --net-startup=<KB>  网络输入起播前的缓冲量（默认 1024）";
+        qDebug() << "  --net-startup=<KB>  Bytes to buffer before network playback starts (default 1024)";
+        // qDebug() << "  --net-rebuffer=<KB> 网络输入卡顿后的重新缓冲量（默认 512）";
+        qDebug() << "  --net-rebuffer=<KB> Bytes to buffer after a network stall (default 512)";
+        // qDebug() << "  --compositor        在独立线程合成字幕和叠加层";
+        qDebug() << "  --compositor        Composite subtitles and overlays on a separate thread";
+        // qDebug() << "  --proxy             解码跟不上实时的视频在后台转码为代理文件";
+        qDebug() << "  --proxy             Transcode videos that cannot decode in real time to a proxy file";
         return 0;
     }
 
     if (!path.isEmpty()) {
-        // 检查路径是否为有效文件
+        // 检查路径是否为有效文件（http/https 地址交给解码器打开）
         QFileInfo fileInfo(path);
-        if (!fileInfo.exists() || !fileInfo.isFile()) {
+        bool isUrl = path.startsWith("http://", Qt::CaseInsensitive) ||
+                     path.startsWith("https://", Qt::CaseInsensitive);
+        if (!isUrl && (!fileInfo.exists() || !fileInfo.isFile())) {
             qDebug() << "Invalid video file path:" << path;
             return 1;
         }